@@ -0,0 +1,274 @@
+/*
+ * Analyse a job history timeline written by the scheduler (see
+ * Scheduler::history_write()).
+ *
+ * schedanalyze [-g object] critical-chain|blame|parallelism [file]
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../schedulerd/scheduler/history.h"
+
+typedef std::map<std::string, std::vector<const JobRecord *>> ByObject;
+
+static void
+usage(const char *argv0)
+{
+	std::cerr << "usage: " << argv0
+		  << " [-g object] critical-chain|blame|parallelism [file]\n";
+	exit(EXIT_FAILURE);
+}
+
+/** Format a duration in microseconds, as e.g. "1.234s" or "56ms". */
+static std::string
+fmt_usec(uint64_t usec)
+{
+	char buf[32];
+
+	if (usec >= 1000000)
+		snprintf(buf, sizeof(buf), "%" PRIu64 ".%03" PRIu64 "s",
+		    usec / 1000000, usec / 1000 % 1000);
+	else if (usec >= 1000)
+		snprintf(buf, sizeof(buf), "%" PRIu64 "ms", usec / 1000);
+	else
+		snprintf(buf, sizeof(buf), "%" PRIu64 "us", usec);
+
+	return buf;
+}
+
+/** Did the job reach its restarter? */
+static bool
+dispatched(const JobRecord &rec)
+{
+	return rec.dispatched != 0 && rec.completed >= rec.dispatched;
+}
+
+/**
+ * Find the job on \p object which \p rec was waiting for: the last of its
+ * jobs to complete before \p rec was able to run.
+ */
+static const JobRecord *
+find_predecessor(const ByObject &by_obj, const std::string &object,
+    const JobRecord &rec)
+{
+	uint64_t before = rec.runnable ? rec.runnable : rec.completed;
+	const JobRecord *best = NULL;
+	auto it = by_obj.find(object);
+
+	if (it == by_obj.end())
+		return NULL;
+
+	for (auto pred : it->second)
+		if (pred != &rec && pred->completed <= before &&
+		    (best == NULL || pred->completed > best->completed))
+			best = pred;
+
+	return best;
+}
+
+static int
+critical_chain(const std::vector<JobRecord> &records, const ByObject &by_obj,
+    uint64_t origin, const std::string &goal)
+{
+	const JobRecord *job = NULL;
+	std::vector<const JobRecord *> chain;
+
+	/* the goal is the last job to complete, unless otherwise specified */
+	for (auto &rec : records)
+		if ((goal.empty() || rec.object == goal) &&
+		    (job == NULL || rec.completed > job->completed))
+			job = &rec;
+
+	if (job == NULL) {
+		std::cerr << "No job found"
+			  << (goal.empty() ? "" : " for " + goal) << "\n";
+		return EXIT_FAILURE;
+	}
+
+	/* walk back along whichever ordering predecessor completed last */
+	while (job != NULL) {
+		const JobRecord *next = NULL;
+
+		chain.push_back(job);
+
+		for (auto &name : job->after) {
+			const JobRecord *pred = find_predecessor(by_obj, name,
+			    *job);
+
+			if (pred != NULL &&
+			    (next == NULL || pred->completed > next->completed))
+				next = pred;
+		}
+
+		job = next;
+	}
+
+	std::cout << "The time when a job completed is printed after \"@\"; "
+		     "the time it ran\nfor is printed after \"+\".\n\n";
+
+	for (size_t i = 0; i < chain.size(); i++) {
+		const JobRecord *rec = chain[i];
+
+		std::cout << std::string(i * 2, ' ') << (i ? "└─" : "")
+			  << rec->object << "/" << rec->type << " @"
+			  << fmt_usec(rec->completed - origin);
+		if (dispatched(*rec))
+			std::cout << " +"
+				  << fmt_usec(rec->completed - rec->dispatched);
+		if (rec->state != "success")
+			std::cout << " (" << rec->state << ")";
+		std::cout << "\n";
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static int
+blame(const std::vector<JobRecord> &records)
+{
+	std::vector<const JobRecord *> sorted;
+
+	for (auto &rec : records)
+		if (dispatched(rec))
+			sorted.push_back(&rec);
+
+	std::sort(sorted.begin(), sorted.end(),
+	    [](const JobRecord *a, const JobRecord *b) {
+		    return a->completed - a->dispatched >
+			b->completed - b->dispatched;
+	    });
+
+	printf("%10s %10s %10s  %s\n", "RUNNING", "ORDERING", "ADMISSION",
+	    "JOB");
+
+	for (auto rec : sorted) {
+		uint64_t ordering = 0, admission = 0;
+
+		if (rec->runnable >= rec->enqueued && rec->enqueued != 0)
+			ordering = rec->runnable - rec->enqueued;
+		if (rec->dispatched >= rec->runnable && rec->runnable != 0)
+			admission = rec->dispatched - rec->runnable;
+
+		printf("%10s %10s %10s  %s/%s%s%s\n",
+		    fmt_usec(rec->completed - rec->dispatched).c_str(),
+		    fmt_usec(ordering).c_str(), fmt_usec(admission).c_str(),
+		    rec->object.c_str(), rec->type.c_str(),
+		    rec->state == "success" ? "" : " ",
+		    rec->state == "success" ? "" : rec->state.c_str());
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static int
+parallelism(const std::vector<JobRecord> &records, uint64_t origin)
+{
+	/* +1 as each job is dispatched, -1 as it completes */
+	std::vector<std::pair<uint64_t, int>> events;
+	int running = 0, peak = 0;
+	uint64_t peak_at = 0, busy = 0, work = 0, last = 0;
+
+	for (auto &rec : records) {
+		if (!dispatched(rec))
+			continue;
+		events.emplace_back(rec.dispatched, 1);
+		events.emplace_back(rec.completed, -1);
+		work += rec.completed - rec.dispatched;
+	}
+
+	/* completions sort before dispatches at the same instant */
+	std::sort(events.begin(), events.end());
+
+	for (auto &event : events) {
+		if (running > 0)
+			busy += event.first - last;
+		last = event.first;
+		running += event.second;
+		if (running > peak) {
+			peak = running;
+			peak_at = event.first;
+		}
+	}
+
+	std::cout << "Jobs dispatched: " << events.size() / 2 << "\n";
+	std::cout << "Maximum parallelism: " << peak << " (at @"
+		  << fmt_usec(peak ? peak_at - origin : 0) << ")\n";
+	if (busy > 0) {
+		char avg[16];
+
+		snprintf(avg, sizeof(avg), "%.2f", (double)work / busy);
+		std::cout << "Average parallelism while busy: " << avg << "\n";
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int
+main(int argc, char *argv[])
+{
+	std::vector<JobRecord> records;
+	ByObject by_obj;
+	std::string goal, cmd;
+	uint64_t origin = UINT64_MAX;
+	bool ok;
+	int c;
+
+	while ((c = getopt(argc, argv, "g:")) != -1) {
+		switch (c) {
+		case 'g':
+			goal = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind >= argc || argc - optind > 2)
+		usage(argv[0]);
+
+	cmd = argv[optind];
+
+	if (argc - optind == 2) {
+		std::ifstream in(argv[optind + 1]);
+
+		if (!in) {
+			perror(argv[optind + 1]);
+			return EXIT_FAILURE;
+		}
+		ok = JobHistory::read(in, records);
+	} else
+		ok = JobHistory::read(std::cin, records);
+
+	if (!ok) {
+		std::cerr << "Malformed job history\n";
+		return EXIT_FAILURE;
+	}
+
+	for (auto &rec : records) {
+		by_obj[rec.object].push_back(&rec);
+		if (rec.enqueued != 0 && rec.enqueued < origin)
+			origin = rec.enqueued;
+	}
+	if (origin == UINT64_MAX)
+		origin = 0;
+
+	if (cmd == "critical-chain")
+		return critical_chain(records, by_obj, origin, goal);
+	else if (cmd == "blame")
+		return blame(records);
+	else if (cmd == "parallelism")
+		return parallelism(records, origin);
+
+	usage(argv[0]);
+	return EXIT_FAILURE;
+}
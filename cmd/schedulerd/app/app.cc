@@ -1,5 +1,4 @@
-#include <sys/event.h>
-
+#include <cstring>
 #include <system_error>
 
 #include "app.h"
@@ -7,66 +6,55 @@
 App::timerid_t
 App::add_timer(bool recur, int ms, Timer::callback_t cb, uintptr_t udata)
 {
-	Timer *timer;
-	struct kevent kev;
+	SlotMap<std::unique_ptr<Timer>>::Handle id;
 	int ret;
 
-	m_timers.emplace_back(std::make_unique<Timer>(cb, udata));
-	timer = m_timers.back().get();
+	id = m_timers.insert(std::make_unique<Timer>(cb, udata, recur));
 
-	EV_SET(&kev, (uintptr_t)timer, EVFILT_TIMER,
-	    EV_ADD | EV_ENABLE | (recur ? 0 : EV_ONESHOT), 0, ms, NULL);
-	ret = kevent(m_kq, &kev, 1, NULL, 0, NULL);
+	ret = m_evloop->add_timer(id, recur, ms);
 	if (ret < 0) {
-		m_timers.pop_back();
-		throw std::system_error(errno, std::generic_category());
+		m_timers.erase(id);
+		throw std::system_error(-ret, std::generic_category());
 	}
 
-	log_trace("Added timer %lu\n", (timerid_t)timer);
+	log_trace("Added timer %lu\n", (timerid_t)id);
 
-	return (timerid_t)timer;
+	return (timerid_t)id;
 }
 
 int
 App::del_timer(timerid_t id)
 {
-	struct kevent kev;
-	int ret;
-
-	for (auto &timer : m_timers) {
-		if ((uintptr_t)timer.get() == id) {
-			EV_SET(&kev, id, EVFILT_TIMER, EV_DELETE, 0, 0, NULL);
-			ret = kevent(m_kq, &kev, 1, NULL, 0, NULL);
-			if (ret < 0)
-				log_dbg("Couldn't remove KQueue timer!");
-
-			m_timers.remove(timer);
-			log_trace("Deleted timer %lu\n", id);
-			return 0;
-		}
+	if (!m_timers.erase(id)) {
+		log_dbg("Couldn't find timer of that ID %lu\n", id);
+		return -ENOENT;
 	}
 
-	log_dbg("Couldn't find timer of that ID %lu\n", id);
-	return -ENOENT;
+	if (m_evloop->del_timer(id) < 0)
+		log_dbg("Couldn't remove %s timer!", m_evloop->name());
+
+	log_trace("Deleted timer %lu\n", id);
+	return 0;
 }
 
 int
 App::add_fd(int fd, int events, FD::callback_t cb)
 {
-	FD *fdo;
-	struct kevent kev;
 	int ret;
 
-	m_fds.emplace_back(std::make_unique<FD>(fd, events, cb));
-	fdo = m_fds.back().get();
+	if (fd < 0)
+		throw std::system_error(EBADF, std::generic_category());
+	else if ((size_t)fd >= m_fds.size())
+		m_fds.resize(fd + 1);
+	else if (m_fds[fd].fd != NULL)
+		throw std::system_error(EEXIST, std::generic_category());
+
+	m_fds[fd].fd = std::make_unique<FD>(fd, events, cb);
 
-	/* we need to use typeof() as libkqueue and BSD kqueue vary */
-	EV_SET(&kev, fd, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0,
-	    (typeof(kev.udata))fdo);
-	ret = kevent(m_kq, &kev, 1, NULL, 0, NULL);
+	ret = m_evloop->add_fd(fd, m_fds[fd].generation);
 	if (ret < 0) {
-		m_fds.pop_back();
-		throw std::system_error(errno, std::generic_category());
+		m_fds[fd].fd.reset();
+		throw std::system_error(-ret, std::generic_category());
 	}
 
 	log_trace("Added FD %d\n", fd);
@@ -77,79 +65,177 @@ App::add_fd(int fd, int events, FD::callback_t cb)
 int
 App::del_fd(int fd)
 {
-	struct kevent kev;
+	if (fd < 0 || (size_t)fd >= m_fds.size() || m_fds[fd].fd == NULL) {
+		log_dbg("Asked to delete watch on FD %d but none exists\n", fd);
+		return -ENOENT;
+	}
+
+	if (m_evloop->del_fd(fd) < 0)
+		log_dbg("Couldn't remove %s FD event!", m_evloop->name());
+
+	m_fds[fd].fd.reset();
+	m_fds[fd].generation++;
+	log_trace("Deleted FD %d\n", fd);
+	return 0;
+}
+
+int
+App::add_signal(int signo, std::function<void(int)> cb)
+{
 	int ret;
 
-	for (auto &fdo : m_fds) {
-		if (fdo->m_fd == fd) {
-			EV_SET(&kev, fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
-			ret = kevent(m_kq, &kev, 1, NULL, 0, NULL);
-			if (ret < 0)
-				log_dbg("Couldn't remove KQueue FD event!");
+	m_signals[signo] = cb;
 
-			m_fds.remove(fdo);
-			log_trace("Deleted FD %d\n", fd);
-			return 0;
-		}
+	ret = m_evloop->add_signal(signo);
+	if (ret < 0) {
+		m_signals.erase(signo);
+		throw std::system_error(-ret, std::generic_category());
 	}
 
-	log_dbg("Asked to delete watch on FD %d but none exists\n", fd);
-	return -ENOENT;
+	log_trace("Added signal %d\n", signo);
+
+	return 0;
 }
 
 void
-App::handle_timer(struct kevent *kev)
+App::handle_timer(Evloop::Event *ev)
 {
-	Timer *timer = (Timer *)kev->ident;
+	timerid_t id = ev->ident;
+	std::unique_ptr<Timer> *slot = m_timers.get(id);
+	std::unique_ptr<Timer> timer;
+
+	if (slot == NULL) {
+		log_trace("Timer %lu elapsed after deletion\n", id);
+		return;
+	}
+
+	log_trace("Timer %lu elapsed\n", id);
+
+	/*
+	 * Hold the timer while its callback runs, as the callback may delete
+	 * it. One-shot timers are done with; recurring ones are put back.
+	 */
+	timer = std::move(*slot);
+	if (!timer->m_recur)
+		m_timers.erase(id);
 
-	log_trace("Timer %lu elapsed\n", timer);
-	timer->m_cb((timerid_t)timer, timer->m_udata);
+	timer->m_cb(id, timer->m_udata);
+
+	if (timer->m_recur && (slot = m_timers.get(id)) != NULL)
+		*slot = std::move(timer);
+}
+
+void
+App::handle_fd(Evloop::Event *ev)
+{
+	int fd = ev->ident;
+
+	if ((size_t)fd >= m_fds.size() || m_fds[fd].fd == NULL ||
+	    m_fds[fd].generation != ev->udata) {
+		log_trace("FD %d had an event after deletion\n", fd);
+		return;
+	}
+
+	log_trace("FD %d had an event\n", fd);
+	/* a copy, as the callback may delete the watch */
+	FD::callback_t cb = m_fds[fd].fd->m_cb;
+	cb(fd);
 }
 
 void
-App::handle_fd(struct kevent *kev)
+App::handle_signal(Evloop::Event *ev)
 {
-	FD *fd = (FD *)kev->udata;
+	auto it = m_signals.find(ev->ident);
+
+	if (it == m_signals.end()) {
+		log_dbg("Signal %lu had no handler\n", ev->ident);
+		return;
+	}
 
-	log_trace("FD %d had an event\n", kev->ident);
-	fd->m_cb(kev->ident);
+	log_trace("Signal %lu delivered\n", ev->ident);
+	it->second(ev->ident);
 }
 
 int
 App::loop()
 {
-	struct kevent rev;
+	Evloop::Event revs[kEventBatch];
 	int ret;
 
 	while (true) {
 		log_trace(" -- iteration --\n");
-		ret = kevent(m_kq, NULL, 0, &rev, 1, NULL);
+		/* don't block if the scheduler has events left to process */
+		ret = m_evloop->wait(revs, kEventBatch,
+		    !m_sched.completions_pending() &&
+			!m_sched.state_changes_pending());
 		if (ret < 0)
-			log_err("KEvent returned %d: %m", ret);
+			log_err("Waiting on %s failed: %s\n", m_evloop->name(),
+			    strerror(-ret));
 		else if (ret == 0)
-			log_dbg("KEvent returned 0\n");
-		else {
-			switch (rev.filter) {
-			case EVFILT_TIMER:
-				handle_timer(&rev);
+			log_trace("Wait returned 0\n");
+
+		for (int i = 0; i < ret; i++) {
+			Evloop::Event *rev = &revs[i];
+
+			/*
+			 * A callback may delete a timer or FD watch whose event
+			 * is later in the batch; such events are recognised as
+			 * stale by their generation, and ignored.
+			 */
+			switch (rev->kind) {
+			case Evloop::Event::kTimer:
+				handle_timer(rev);
+				break;
+			case Evloop::Event::kFD:
+				handle_fd(rev);
 				break;
-			case EVFILT_READ:
-				handle_fd(&rev);
+			case Evloop::Event::kSignal:
+				handle_signal(rev);
 				break;
 			default:
-				log_err("Unhandled KEvent filter!\n");
+				log_err("Unhandled event kind %d!\n", rev->kind);
 			}
 		}
+
+		m_sched.dispatch_completions();
+		m_sched.dispatch_state_changes();
 		m_js.run_pending_jobs();
 	}
 
 	return 0;
 }
 
+size_t
+App::restarter_index(const std::string &type)
+{
+	auto it = restarter_types.find(type);
+
+	if (it != restarter_types.end())
+		return it->second;
+
+	restarters.push_back(NULL);
+	restarter_types[type] = restarters.size() - 1;
+
+	return restarters.size() - 1;
+}
+
+size_t
+App::restarter_register(const std::string &type, Restarter *restarter)
+{
+	size_t idx = restarter_index(type);
+
+	restarters[idx] = restarter;
+	log_trace("Registered restarter for type %s\n", type.c_str());
+
+	return idx;
+}
+
 App::App()
-    : m_js(*this)
+    : m_evloop(Evloop::Backend::create())
+    , m_js(*this)
     , m_sched(*this)
+    , m_procman(*this)
+    , m_pool(*this)
 {
-	m_kq = kqueue();
 	printf("INITIALISING APP...\n\n");
 }
@@ -6,16 +6,17 @@
 #include <functional>
 
 #include "../js/js.h"
+#include "../procman/procman.h"
 #include "../restarters/restarter.h"
 #include "../scheduler/scheduler.h"
 #include "evloop.h"
+#include "iwng_compat/slotmap.h"
+#include "workpool.h"
 
 #define log_trace(...)
 #define log_dbg(...) printf(__VA_ARGS__)
 #define log_err(...) fprintf(stderr, __VA_ARGS__)
 
-struct kevent;
-
 class App {
 
     public:
@@ -27,10 +28,12 @@ class App {
 
 		callback_t m_cb; //!< callback to invoke on timer elapse
 		uintptr_t m_udata;
+		bool m_recur; //!< whether it is rearmed after it elapses
 
-		Timer(callback_t cb, uintptr_t udata = 0)
+		Timer(callback_t cb, uintptr_t udata = 0, bool recur = false)
 		    : m_cb(cb)
-		    , m_udata(udata) {};
+		    , m_udata(udata)
+		    , m_recur(recur) {};
 	};
 
 	struct FD {
@@ -47,21 +50,65 @@ class App {
 		    , m_cb(cb) {};
 	};
 
-	std::list<std::unique_ptr<Timer>> m_timers;
-	std::list<std::unique_ptr<FD>> m_fds;
+	/** An FD watch, if any, and the generation of its slot. */
+	struct FDSlot {
+		uint32_t generation = 1; /**< advanced as the watch is deleted */
+		std::unique_ptr<FD> fd;
+	};
 
-	void handle_timer(struct kevent *kev);
-	void handle_fd(struct kevent *kev);
+	/** Handlers of signals watched, by signal number. */
+	std::unordered_map<int, std::function<void(int)>> m_signals;
+
+	/** Timers; a timer's ID is its handle. */
+	SlotMap<std::unique_ptr<Timer>> m_timers;
+	/** FD watches, indexed by FD number. */
+	std::vector<FDSlot> m_fds;
+
+	/**
+	 * Handle a timer event. Events for timers since deleted are ignored;
+	 * one-shot timers are freed once they have elapsed.
+	 */
+	void handle_timer(Evloop::Event *ev);
+	/**
+	 * Handle an FD event. The event carries the generation of the watch's
+	 * slot, so that events for watches since deleted are ignored.
+	 */
+	void handle_fd(Evloop::Event *ev);
+	/** Handle a signal event. */
+	void handle_signal(Evloop::Event *ev);
 
     public:
-	int m_kq;
+	/** Maximum number of events harvested per wakeup. */
+	static constexpr int kEventBatch = 64;
+
+	std::unique_ptr<Evloop::Backend> m_evloop; /**< OS event facility */
 	JS m_js;
 	Scheduler m_sched;
-	/** Object type to restarter. */
-	std::unordered_map<std::string, Restarter *> restarters;
+	ProcMan m_procman;
+	/**
+	 * Worker threads for blocking and CPU-bound work. Declared after the JS
+	 * runtime and scheduler, so its threads are joined before those are
+	 * torn down.
+	 */
+	WorkPool m_pool;
+	/** Restarters, indexed by object type index; NULL if unregistered. */
+	std::vector<Restarter *> restarters;
+	/** Object type name to index into #restarters. */
+	std::unordered_map<std::string, size_t> restarter_types;
 
 	App();
 
+	/**
+	 * Get the index into #restarters for an object type. An index is
+	 * reserved for a type with no restarter registered yet.
+	 */
+	size_t restarter_index(const std::string &type);
+	/**
+	 * Register the restarter for an object type. Returns the type's index
+	 * into #restarters.
+	 */
+	size_t restarter_register(const std::string &type, Restarter *restarter);
+
 	/** Add a new timer. Returns 0 on failure, otherwise unique ID. */
 	timerid_t add_timer(bool recur, int ms, Timer::callback_t cb,
 	    uintptr_t udata = 0);
@@ -70,6 +117,12 @@ class App {
 	int add_fd(int fd, int events, FD::callback_t cb);
 	int del_fd(int fd);
 
+	/**
+	 * Watch for a signal, which is blocked so that it is delivered only
+	 * to \p cb, from the loop.
+	 */
+	int add_signal(int signo, std::function<void(int)> cb);
+
 	int loop();
 };
 
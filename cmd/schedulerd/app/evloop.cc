@@ -0,0 +1,31 @@
+#include <system_error>
+
+#include "evloop.h"
+
+#if defined(EVLOOP_IO_URING)
+#include "evloop_uring.h"
+#endif
+#if defined(EVLOOP_EPOLL)
+#include "evloop_epoll.h"
+#elif defined(EVLOOP_KQUEUE)
+#include "evloop_kqueue.h"
+#else
+#error "No event loop backend configured"
+#endif
+
+std::unique_ptr<Evloop::Backend>
+Evloop::Backend::create()
+{
+#if defined(EVLOOP_IO_URING)
+	try {
+		return std::make_unique<UringBackend>();
+	} catch (const std::system_error &) {
+		/* e.g. too old a kernel, or disabled by sysctl; use epoll */
+	}
+#endif
+#if defined(EVLOOP_EPOLL)
+	return std::make_unique<EpollBackend>();
+#else
+	return std::make_unique<KQueueBackend>();
+#endif
+}
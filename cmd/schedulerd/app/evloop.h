@@ -3,8 +3,67 @@
 
 #include "sys/types.h"
 
+#include <cstdint>
+#include <memory>
+
 namespace Evloop {
 typedef uintptr_t timerid_t;
+
+/** An event harvested from a backend. */
+struct Event {
+	enum Kind {
+		kTimer,	 /**< a timer elapsed */
+		kFD,	 /**< an FD is ready */
+		kSignal, /**< a signal was delivered */
+	} kind;
+	uintptr_t ident; /**< timer ID, FD number, or signal number */
+	uintptr_t udata; /**< for an FD, as given to Backend::add_fd() */
+};
+
+/**
+ * The OS facility which the event loop waits on.
+ *
+ * Methods return 0 on success or -errno on failure; constructors of backends
+ * throw std::system_error if the facility is unavailable.
+ */
+class Backend {
+    public:
+	virtual ~Backend() = default;
+
+	/** Name of the backend, for diagnostics. */
+	virtual const char *name() const = 0;
+
+	/**
+	 * Arm a timer to elapse after \p ms milliseconds, and thereafter every
+	 * \p ms milliseconds if \p recur. \p id must be unique among timers.
+	 */
+	virtual int add_timer(timerid_t id, bool recur, int ms) = 0;
+	/** Disarm a timer. */
+	virtual int del_timer(timerid_t id) = 0;
+
+	/** Watch an FD for readability; \p udata is returned with events. */
+	virtual int add_fd(int fd, uintptr_t udata) = 0;
+	/** Stop watching an FD. */
+	virtual int del_fd(int fd) = 0;
+
+	/**
+	 * Watch for a signal. The signal is blocked, so that it is delivered
+	 * only as an event.
+	 */
+	virtual int add_signal(int signo) = 0;
+
+	/**
+	 * Harvest events.
+	 * @param events Array in which to store events.
+	 * @param max Size of \p events.
+	 * @param block Whether to wait for an event if none is ready.
+	 * @returns Number of events stored, or -errno.
+	 */
+	virtual int wait(Event *events, int max, bool block) = 0;
+
+	/** Create the preferred backend for this platform. */
+	static std::unique_ptr<Backend> create();
+};
 }
 
 #endif /* EVLOOP_H_ */
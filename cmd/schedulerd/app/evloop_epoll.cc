@@ -0,0 +1,193 @@
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#include <cerrno>
+#include <system_error>
+#include <unistd.h>
+
+#include "evloop_epoll.h"
+#include "iwng_compat/misc_cxx.h"
+
+EpollBackend::EpollBackend()
+    : m_wheel(monotonic_usec())
+{
+	struct epoll_event ev = {};
+
+	m_epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epfd < 0)
+		throw std::system_error(errno, std::generic_category());
+
+	m_timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (m_timerfd < 0) {
+		close(m_epfd);
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = m_timerfd;
+	if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, m_timerfd, &ev) < 0) {
+		close(m_timerfd);
+		close(m_epfd);
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	sigemptyset(&m_sigmask);
+}
+
+EpollBackend::~EpollBackend()
+{
+	if (m_sigfd >= 0)
+		close(m_sigfd);
+	close(m_timerfd);
+	close(m_epfd);
+}
+
+const char *
+EpollBackend::name() const
+{
+	return "epoll";
+}
+
+int
+EpollBackend::add_timer(Evloop::timerid_t id, bool recur, int ms)
+{
+	uint64_t interval = (uint64_t)ms * 1000;
+
+	m_wheel.add(id, monotonic_usec() + interval, recur ? interval : 0);
+	return 0;
+}
+
+int
+EpollBackend::del_timer(Evloop::timerid_t id)
+{
+	return m_wheel.del(id) ? 0 : -ENOENT;
+}
+
+int
+EpollBackend::add_fd(int fd, uintptr_t udata)
+{
+	struct epoll_event ev = {};
+
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		return -errno;
+
+	if ((size_t)fd >= m_udata.size())
+		m_udata.resize(fd + 1);
+	m_udata[fd] = udata;
+
+	return 0;
+}
+
+int
+EpollBackend::del_fd(int fd)
+{
+	if (epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd, NULL) < 0)
+		return -errno;
+	return 0;
+}
+
+int
+EpollBackend::add_signal(int signo)
+{
+	struct epoll_event ev = {};
+	bool first = m_sigfd < 0;
+	int fd;
+
+	sigaddset(&m_sigmask, signo);
+	if (sigprocmask(SIG_BLOCK, &m_sigmask, NULL) < 0)
+		return -errno;
+
+	/* on an existing signalfd, this updates the mask */
+	fd = signalfd(m_sigfd, &m_sigmask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	m_sigfd = fd;
+
+	if (first) {
+		ev.events = EPOLLIN;
+		ev.data.fd = m_sigfd;
+		if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, m_sigfd, &ev) < 0)
+			return -errno;
+	}
+
+	return 0;
+}
+
+int
+EpollBackend::arm_timerfd()
+{
+	uint64_t next = m_wheel.next_deadline();
+	struct itimerspec its = {};
+
+	if (next == m_armed)
+		return 0;
+
+	/* a zero it_value disarms; the deadline is never 0 in practice */
+	if (next != UINT64_MAX) {
+		its.it_value.tv_sec = next / 1000000;
+		its.it_value.tv_nsec = next % 1000000 * 1000;
+	}
+	if (timerfd_settime(m_timerfd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+		return -errno;
+
+	m_armed = next;
+	return 0;
+}
+
+void
+EpollBackend::read_signals()
+{
+	struct signalfd_siginfo si;
+
+	while (read(m_sigfd, &si, sizeof(si)) == sizeof(si))
+		m_pending.push_back(
+		    { Evloop::Event::kSignal, si.ssi_signo, 0 });
+}
+
+int
+EpollBackend::wait(Evloop::Event *events, int max, bool block)
+{
+	int nrevs, n = 0, r;
+
+	if ((r = arm_timerfd()) < 0)
+		return r;
+
+	if ((int)m_revs.size() < max)
+		m_revs.resize(max);
+
+	nrevs = epoll_wait(m_epfd, m_revs.data(), max,
+	    block && m_pending.empty() ? -1 : 0);
+	if (nrevs < 0)
+		return -errno;
+
+	for (int i = 0; i < nrevs; i++) {
+		int fd = m_revs[i].data.fd;
+
+		if (fd == m_timerfd) {
+			uint64_t expirations;
+
+			/* just to clear it; the wheel tells what elapsed */
+			(void)read(m_timerfd, &expirations,
+			    sizeof(expirations));
+			m_armed = UINT64_MAX;
+		} else if (fd == m_sigfd)
+			read_signals();
+		else
+			events[n++] = { Evloop::Event::kFD, (uintptr_t)fd,
+				m_udata[fd] };
+	}
+
+	m_expired.clear();
+	m_wheel.advance(monotonic_usec(), m_expired);
+	for (auto id : m_expired)
+		m_pending.push_back({ Evloop::Event::kTimer, id, 0 });
+
+	while (n < max && !m_pending.empty()) {
+		events[n++] = m_pending.front();
+		m_pending.pop_front();
+	}
+
+	return n;
+}
@@ -0,0 +1,49 @@
+#ifndef EVLOOP_EPOLL_H_
+#define EVLOOP_EPOLL_H_
+
+#include <sys/epoll.h>
+
+#include <csignal>
+#include <deque>
+#include <vector>
+
+#include "evloop.h"
+#include "timerwheel.h"
+
+/**
+ * Native Linux backend: epoll for FDs, a single timerfd armed for the
+ * earliest deadline of a timer wheel, and a signalfd for signals.
+ */
+class EpollBackend : public Evloop::Backend {
+    public:
+	EpollBackend();
+	~EpollBackend();
+
+	const char *name() const;
+	int add_timer(Evloop::timerid_t id, bool recur, int ms);
+	int del_timer(Evloop::timerid_t id);
+	int add_fd(int fd, uintptr_t udata);
+	int del_fd(int fd);
+	int add_signal(int signo);
+	int wait(Evloop::Event *events, int max, bool block);
+
+    private:
+	int m_epfd;
+	int m_timerfd;
+	int m_sigfd = -1;
+	sigset_t m_sigmask;		 /**< signals watched by #m_sigfd */
+	uint64_t m_armed = UINT64_MAX;	 /**< deadline #m_timerfd is set for */
+	TimerWheel m_wheel;
+	std::vector<uintptr_t> m_udata; /**< udata of FD watches, by FD */
+	std::vector<struct epoll_event> m_revs; /**< reused by wait() */
+	std::vector<Evloop::timerid_t> m_expired; /**< reused by wait() */
+	/** Timer and signal events not yet returned for want of room. */
+	std::deque<Evloop::Event> m_pending;
+
+	/** Set #m_timerfd for the earliest deadline in the wheel. */
+	int arm_timerfd();
+	/** Read pending signals from #m_sigfd into #m_pending. */
+	void read_signals();
+};
+
+#endif /* EVLOOP_EPOLL_H_ */
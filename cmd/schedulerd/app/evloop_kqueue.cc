@@ -0,0 +1,125 @@
+#include <cerrno>
+#include <csignal>
+#include <system_error>
+#include <unistd.h>
+
+#include "evloop_kqueue.h"
+
+KQueueBackend::KQueueBackend()
+{
+	m_kq = kqueue();
+	if (m_kq < 0)
+		throw std::system_error(errno, std::generic_category());
+}
+
+KQueueBackend::~KQueueBackend()
+{
+	close(m_kq);
+}
+
+const char *
+KQueueBackend::name() const
+{
+	return "kqueue";
+}
+
+int
+KQueueBackend::change(struct kevent *kev)
+{
+	if (kevent(m_kq, kev, 1, NULL, 0, NULL) < 0)
+		return -errno;
+	return 0;
+}
+
+int
+KQueueBackend::add_timer(Evloop::timerid_t id, bool recur, int ms)
+{
+	struct kevent kev;
+
+	EV_SET(&kev, id, EVFILT_TIMER,
+	    EV_ADD | EV_ENABLE | (recur ? 0 : EV_ONESHOT), 0, ms, NULL);
+	return change(&kev);
+}
+
+int
+KQueueBackend::del_timer(Evloop::timerid_t id)
+{
+	struct kevent kev;
+
+	EV_SET(&kev, id, EVFILT_TIMER, EV_DELETE, 0, 0, NULL);
+	return change(&kev);
+}
+
+int
+KQueueBackend::add_fd(int fd, uintptr_t udata)
+{
+	struct kevent kev;
+
+	/* we need to use typeof() as libkqueue and BSD kqueue vary */
+	EV_SET(&kev, fd, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0,
+	    (typeof(kev.udata))udata);
+	return change(&kev);
+}
+
+int
+KQueueBackend::del_fd(int fd)
+{
+	struct kevent kev;
+
+	EV_SET(&kev, fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+	return change(&kev);
+}
+
+int
+KQueueBackend::add_signal(int signo)
+{
+	struct kevent kev;
+	sigset_t mask;
+
+	/* kqueue sees signals even if blocked; block to stop default action */
+	sigemptyset(&mask);
+	sigaddset(&mask, signo);
+	if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0)
+		return -errno;
+
+	EV_SET(&kev, signo, EVFILT_SIGNAL, EV_ADD | EV_ENABLE, 0, 0, NULL);
+	return change(&kev);
+}
+
+int
+KQueueBackend::wait(Evloop::Event *events, int max, bool block)
+{
+	struct timespec nowait = { 0, 0 };
+	int nrevs, n = 0;
+
+	if ((int)m_revs.size() < max)
+		m_revs.resize(max);
+
+	nrevs = kevent(m_kq, NULL, 0, m_revs.data(), max,
+	    block ? NULL : &nowait);
+	if (nrevs < 0)
+		return -errno;
+
+	for (int i = 0; i < nrevs; i++) {
+		struct kevent *rev = &m_revs[i];
+
+		switch (rev->filter) {
+		case EVFILT_TIMER:
+			events[n++] = { Evloop::Event::kTimer, rev->ident, 0 };
+			break;
+		case EVFILT_READ:
+			events[n++] = { Evloop::Event::kFD, rev->ident,
+				(uintptr_t)rev->udata };
+			break;
+		case EVFILT_SIGNAL:
+			events[n++] = { Evloop::Event::kSignal, rev->ident,
+				0 };
+			break;
+		default:
+			/* not ours */
+			break;
+		}
+	}
+
+	return n;
+}
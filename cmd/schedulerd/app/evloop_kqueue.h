@@ -0,0 +1,35 @@
+#ifndef EVLOOP_KQUEUE_H_
+#define EVLOOP_KQUEUE_H_
+
+#include <sys/event.h>
+
+#include <vector>
+
+#include "evloop.h"
+
+/**
+ * Kernel Queues backend, native on the BSDs (and available on Linux through
+ * libkqueue).
+ */
+class KQueueBackend : public Evloop::Backend {
+    public:
+	KQueueBackend();
+	~KQueueBackend();
+
+	const char *name() const;
+	int add_timer(Evloop::timerid_t id, bool recur, int ms);
+	int del_timer(Evloop::timerid_t id);
+	int add_fd(int fd, uintptr_t udata);
+	int del_fd(int fd);
+	int add_signal(int signo);
+	int wait(Evloop::Event *events, int max, bool block);
+
+    private:
+	int m_kq;
+	std::vector<struct kevent> m_revs; /**< reused by wait() */
+
+	/** Apply a single change to the kqueue. */
+	int change(struct kevent *kev);
+};
+
+#endif /* EVLOOP_KQUEUE_H_ */
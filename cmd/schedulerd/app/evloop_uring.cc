@@ -0,0 +1,247 @@
+#include <sys/poll.h>
+
+#include <cerrno>
+#include <system_error>
+#include <unistd.h>
+
+#include "evloop_uring.h"
+#include "iwng_compat/misc_cxx.h"
+
+UringBackend::UringBackend()
+    : m_wheel(monotonic_usec())
+{
+	int r = io_uring_queue_init(kEntries, &m_ring, 0);
+
+	if (r < 0)
+		throw std::system_error(-r, std::generic_category());
+
+	sigemptyset(&m_sigmask);
+}
+
+UringBackend::~UringBackend()
+{
+	if (m_sigfd >= 0)
+		close(m_sigfd);
+	io_uring_queue_exit(&m_ring);
+}
+
+const char *
+UringBackend::name() const
+{
+	return "io_uring";
+}
+
+uint64_t
+UringBackend::user_data(Tag tag, uint32_t seq, int fd)
+{
+	return (uint64_t)tag << 56 | (uint64_t)(seq & 0xffffff) << 32 |
+	    (uint32_t)fd;
+}
+
+struct io_uring_sqe *
+UringBackend::get_sqe()
+{
+	struct io_uring_sqe *sqe = io_uring_get_sqe(&m_ring);
+
+	/* queue full; submit what's there early to make room */
+	if (sqe == NULL && io_uring_submit(&m_ring) >= 0)
+		sqe = io_uring_get_sqe(&m_ring);
+
+	return sqe;
+}
+
+void
+UringBackend::queue_poll(int fd)
+{
+	struct io_uring_sqe *sqe = get_sqe();
+
+	if (sqe == NULL) {
+		m_watches[fd].active = false;
+		return;
+	}
+
+	io_uring_prep_poll_multishot(sqe, fd, POLLIN);
+	io_uring_sqe_set_data64(sqe,
+	    user_data(kPoll, m_watches[fd].seq, fd));
+}
+
+void
+UringBackend::queue_signal_read()
+{
+	struct io_uring_sqe *sqe = get_sqe();
+
+	if (sqe == NULL)
+		return;
+
+	io_uring_prep_read(sqe, m_sigfd, &m_siginfo, sizeof(m_siginfo), 0);
+	io_uring_sqe_set_data64(sqe, user_data(kSignal, 0, m_sigfd));
+}
+
+int
+UringBackend::add_timer(Evloop::timerid_t id, bool recur, int ms)
+{
+	uint64_t interval = (uint64_t)ms * 1000;
+
+	m_wheel.add(id, monotonic_usec() + interval, recur ? interval : 0);
+	return 0;
+}
+
+int
+UringBackend::del_timer(Evloop::timerid_t id)
+{
+	return m_wheel.del(id) ? 0 : -ENOENT;
+}
+
+int
+UringBackend::add_fd(int fd, uintptr_t udata)
+{
+	if (fd < 0)
+		return -EBADF;
+	else if ((size_t)fd >= m_watches.size())
+		m_watches.resize(fd + 1);
+	else if (m_watches[fd].active)
+		return -EEXIST;
+
+	m_watches[fd].active = true;
+	m_watches[fd].seq++;
+	m_watches[fd].udata = udata;
+	queue_poll(fd);
+
+	return m_watches[fd].active ? 0 : -EBUSY;
+}
+
+int
+UringBackend::del_fd(int fd)
+{
+	struct io_uring_sqe *sqe;
+
+	if (fd < 0 || (size_t)fd >= m_watches.size() || !m_watches[fd].active)
+		return -ENOENT;
+
+	/* any completions still to come for the poll are recognised as stale */
+	m_watches[fd].active = false;
+
+	if ((sqe = get_sqe()) == NULL)
+		return -EBUSY;
+	io_uring_prep_poll_remove(sqe,
+	    user_data(kPoll, m_watches[fd].seq, fd));
+	io_uring_sqe_set_data64(sqe, user_data(kIgnore, 0, fd));
+
+	return 0;
+}
+
+int
+UringBackend::add_signal(int signo)
+{
+	bool first = m_sigfd < 0;
+	int fd;
+
+	sigaddset(&m_sigmask, signo);
+	if (sigprocmask(SIG_BLOCK, &m_sigmask, NULL) < 0)
+		return -errno;
+
+	/* blocking, so that io_uring waits for a signal rather than failing */
+	fd = signalfd(m_sigfd, &m_sigmask, SFD_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	m_sigfd = fd;
+
+	if (first)
+		queue_signal_read();
+
+	return 0;
+}
+
+void
+UringBackend::complete(struct io_uring_cqe *cqe)
+{
+	uint64_t data = io_uring_cqe_get_data64(cqe);
+	uint32_t seq = data >> 32 & 0xffffff;
+	int fd = (uint32_t)data;
+
+	switch (data >> 56) {
+	case kPoll: {
+		Watch *watch;
+
+		if ((size_t)fd >= m_watches.size())
+			break;
+
+		watch = &m_watches[fd];
+		if (!watch->active || (watch->seq & 0xffffff) != seq)
+			break; /* stale */
+		else if (cqe->res < 0) {
+			/* e.g. the FD was closed while watched */
+			watch->active = false;
+			break;
+		}
+
+		m_pending.push_back({ Evloop::Event::kFD, (uintptr_t)fd,
+		    watch->udata });
+
+		/* the kernel may end a multishot poll; if so, rearm it */
+		if (!(cqe->flags & IORING_CQE_F_MORE))
+			queue_poll(fd);
+		break;
+	}
+
+	case kSignal:
+		if (cqe->res == sizeof(m_siginfo))
+			m_pending.push_back({ Evloop::Event::kSignal,
+			    m_siginfo.ssi_signo, 0 });
+		if (cqe->res >= 0 || cqe->res == -EINTR || cqe->res == -EAGAIN)
+			queue_signal_read();
+		break;
+
+	default:
+		break;
+	}
+}
+
+int
+UringBackend::wait(Evloop::Event *events, int max, bool block)
+{
+	struct io_uring_cqe *cqe;
+	struct __kernel_timespec ts, *tsp = NULL;
+	uint64_t next = m_wheel.next_deadline();
+	unsigned head, nreaped = 0;
+	int r, n = 0;
+
+	/* one system call submits everything queued and waits */
+	if (!block || !m_pending.empty())
+		r = io_uring_submit(&m_ring);
+	else {
+		if (next != UINT64_MAX) {
+			uint64_t now = monotonic_usec();
+			uint64_t delta = next > now ? next - now : 0;
+
+			ts.tv_sec = delta / 1000000;
+			ts.tv_nsec = delta % 1000000 * 1000;
+			tsp = &ts;
+		}
+		r = io_uring_submit_and_wait_timeout(&m_ring, &cqe, 1, tsp,
+		    NULL);
+		if (r == -ETIME || r == -EINTR)
+			r = 0;
+	}
+	if (r < 0)
+		return r;
+
+	io_uring_for_each_cqe(&m_ring, head, cqe)
+	{
+		complete(cqe);
+		nreaped++;
+	}
+	io_uring_cq_advance(&m_ring, nreaped);
+
+	m_expired.clear();
+	m_wheel.advance(monotonic_usec(), m_expired);
+	for (auto id : m_expired)
+		m_pending.push_back({ Evloop::Event::kTimer, id, 0 });
+
+	while (n < max && !m_pending.empty()) {
+		events[n++] = m_pending.front();
+		m_pending.pop_front();
+	}
+
+	return n;
+}
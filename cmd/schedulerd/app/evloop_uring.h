@@ -0,0 +1,75 @@
+#ifndef EVLOOP_URING_H_
+#define EVLOOP_URING_H_
+
+#include <sys/signalfd.h>
+
+#include <csignal>
+#include <deque>
+#include <liburing.h>
+#include <vector>
+
+#include "evloop.h"
+#include "timerwheel.h"
+
+/**
+ * Linux io_uring backend.
+ *
+ * Registrations are not made by a system call each: they queue submissions,
+ * which are submitted together with the wait for completions, in a single
+ * io_uring_enter() per loop iteration. FDs are watched by multishot polls,
+ * signals are read from a signalfd by read submissions, and the timer wheel's
+ * earliest deadline bounds the wait. Completions are reaped in bulk.
+ */
+class UringBackend : public Evloop::Backend {
+    public:
+	static constexpr unsigned kEntries = 256; /**< submission queue size */
+
+	UringBackend();
+	~UringBackend();
+
+	const char *name() const;
+	int add_timer(Evloop::timerid_t id, bool recur, int ms);
+	int del_timer(Evloop::timerid_t id);
+	int add_fd(int fd, uintptr_t udata);
+	int del_fd(int fd);
+	int add_signal(int signo);
+	int wait(Evloop::Event *events, int max, bool block);
+
+    private:
+	/** What a submission was for; kept in the top byte of user_data. */
+	enum Tag : uint64_t {
+		kPoll = 1,   /**< poll of a watched FD */
+		kSignal = 2, /**< read from the signalfd */
+		kIgnore = 3, /**< completion of interest to no one */
+	};
+
+	/** An FD watch. */
+	struct Watch {
+		bool active = false;
+		uint32_t seq = 0; /**< distinguishes successive watches */
+		uintptr_t udata = 0;
+	};
+
+	struct io_uring m_ring;
+	TimerWheel m_wheel;
+	std::vector<Watch> m_watches; /**< indexed by FD */
+	int m_sigfd = -1;
+	sigset_t m_sigmask;		    /**< signals watched by #m_sigfd */
+	struct signalfd_siginfo m_siginfo; /**< buffer for signalfd reads */
+	std::vector<Evloop::timerid_t> m_expired; /**< reused by wait() */
+	/** Events not yet returned for want of room. */
+	std::deque<Evloop::Event> m_pending;
+
+	/** Get a submission queue entry, submitting the queue if it is full. */
+	struct io_uring_sqe *get_sqe();
+	/** Queue a multishot poll for a watched FD. */
+	void queue_poll(int fd);
+	/** Queue a read of the next signal from #m_sigfd. */
+	void queue_signal_read();
+	/** Handle a completion, queueing any event it yields. */
+	void complete(struct io_uring_cqe *cqe);
+
+	static uint64_t user_data(Tag tag, uint32_t seq, int fd);
+};
+
+#endif /* EVLOOP_URING_H_ */
@@ -0,0 +1,120 @@
+#include <algorithm>
+
+#include "timerwheel.h"
+
+TimerWheel::TimerWheel(uint64_t now)
+    : m_slots(kSlots)
+    , m_tick(now / kTickUsec)
+    , m_next(UINT64_MAX)
+{
+}
+
+void
+TimerWheel::insert(Entry entry)
+{
+	/* a deadline already past goes in the current slot, to fire next */
+	uint64_t tick = std::max(entry.deadline / kTickUsec, m_tick);
+	size_t slot = tick % kSlots;
+	auto &list = m_slots[slot];
+
+	if (m_next_valid && entry.deadline < m_next)
+		m_next = entry.deadline;
+
+	m_index[entry.id] = { slot, list.insert(list.end(), entry) };
+}
+
+void
+TimerWheel::add(Evloop::timerid_t id, uint64_t deadline, uint64_t interval)
+{
+	del(id);
+	insert({ id, deadline, interval });
+}
+
+bool
+TimerWheel::del(Evloop::timerid_t id)
+{
+	auto it = m_index.find(id);
+
+	if (it == m_index.end())
+		return false;
+
+	if (it->second.second->deadline == m_next)
+		m_next_valid = false;
+	m_slots[it->second.first].erase(it->second.second);
+	m_index.erase(it);
+
+	return true;
+}
+
+uint64_t
+TimerWheel::next_deadline()
+{
+	uint64_t earliest = UINT64_MAX;
+
+	if (m_next_valid)
+		return m_next;
+
+	/*
+	 * Visit slots in the order of their ticks. The first slot with a timer
+	 * due in this revolution holds the earliest; failing that, every timer
+	 * is due in a later revolution and the earliest of all is wanted.
+	 */
+	for (uint64_t tick = m_tick; tick < m_tick + kSlots; tick++) {
+		uint64_t due = UINT64_MAX;
+
+		for (auto &entry : m_slots[tick % kSlots]) {
+			earliest = std::min(earliest, entry.deadline);
+			if (entry.deadline / kTickUsec <= tick)
+				due = std::min(due, entry.deadline);
+		}
+
+		if (due != UINT64_MAX) {
+			earliest = due;
+			break;
+		}
+	}
+
+	m_next = earliest;
+	m_next_valid = true;
+
+	return m_next;
+}
+
+void
+TimerWheel::advance(uint64_t now, std::vector<Evloop::timerid_t> &expired)
+{
+	uint64_t target = std::max(now / kTickUsec, m_tick), first = m_tick;
+	std::vector<Entry> rearm;
+
+	/* no need to go round more than once */
+	if (target - first >= kSlots)
+		first = target - kSlots + 1;
+
+	for (uint64_t tick = first; tick <= target; tick++) {
+		auto &list = m_slots[tick % kSlots];
+
+		for (auto it = list.begin(); it != list.end();) {
+			if (it->deadline > now) {
+				it++;
+				continue;
+			}
+
+			expired.push_back(it->id);
+			if (it->interval != 0)
+				rearm.push_back(*it);
+			m_index.erase(it->id);
+			it = list.erase(it);
+			m_next_valid = false;
+		}
+	}
+
+	m_tick = target;
+
+	for (auto &entry : rearm) {
+		entry.deadline += entry.interval;
+		/* if we have fallen behind, don't fire repeatedly to catch up */
+		if (entry.deadline <= now)
+			entry.deadline = now + entry.interval;
+		insert(entry);
+	}
+}
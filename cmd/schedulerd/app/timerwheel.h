@@ -0,0 +1,66 @@
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "evloop.h"
+
+/**
+ * A hashed timing wheel, for backends which have only a single timer (e.g. a
+ * timerfd) to wait on.
+ *
+ * Timers are hashed by the tick of their deadline into one of #kSlots slots;
+ * a slot holds timers for every revolution of the wheel. Adding and deleting a
+ * timer is constant-time, and advancing the wheel visits only the slots of the
+ * ticks elapsed.
+ */
+class TimerWheel {
+    public:
+	static constexpr unsigned kSlots = 256;	     /**< slots in the wheel */
+	static constexpr uint64_t kTickUsec = 1000; /**< resolution of a slot */
+
+	/** Create a wheel whose time begins at \p now (in microseconds). */
+	TimerWheel(uint64_t now);
+
+	/**
+	 * Add a timer to elapse at \p deadline, then every \p interval if it
+	 * is non-zero. A timer already added with the same ID is replaced.
+	 */
+	void add(Evloop::timerid_t id, uint64_t deadline, uint64_t interval);
+	/**
+	 * Delete a timer.
+	 * @retval false No timer has that ID.
+	 */
+	bool del(Evloop::timerid_t id);
+
+	/** Deadline of the earliest timer, or UINT64_MAX if there are none. */
+	uint64_t next_deadline();
+	/**
+	 * Advance the wheel to \p now, appending the IDs of timers elapsed to
+	 * \p expired. Recurring timers are rearmed.
+	 */
+	void advance(uint64_t now, std::vector<Evloop::timerid_t> &expired);
+
+    private:
+	struct Entry {
+		Evloop::timerid_t id;
+		uint64_t deadline;
+		uint64_t interval; /**< 0 if not recurring */
+	};
+	typedef std::list<Entry>::iterator EntryPos;
+
+	std::vector<std::list<Entry>> m_slots;
+	std::unordered_map<Evloop::timerid_t, std::pair<size_t, EntryPos>>
+	    m_index;		 /**< timer ID to its slot and position */
+	uint64_t m_tick;	 /**< tick up to which the wheel has advanced */
+	uint64_t m_next;	 /**< cached result of next_deadline() */
+	bool m_next_valid = true; /**< is #m_next current? */
+
+	/** Insert an entry into the slot for its deadline. */
+	void insert(Entry entry);
+};
+
+#endif /* TIMERWHEEL_H_ */
@@ -0,0 +1,154 @@
+#include <sys/eventfd.h>
+
+#include <cerrno>
+#include <system_error>
+#include <unistd.h>
+
+#include "app.h"
+#include "workpool.h"
+
+/* the pool and worker index of the current thread, if it is a worker */
+static thread_local WorkPool *t_pool = NULL;
+static thread_local size_t t_self;
+
+WorkPool::WorkPool(App &app, unsigned nthreads)
+    : m_app(app)
+{
+	if (nthreads == 0)
+		nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+	m_eventfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (m_eventfd < 0)
+		throw std::system_error(errno, std::generic_category());
+	m_app.add_fd(m_eventfd, POLLIN,
+	    std::bind(&WorkPool::drain, this, std::placeholders::_1));
+
+	for (unsigned i = 0; i < nthreads; i++)
+		m_workers.emplace_back(std::make_unique<Worker>());
+	/* only start them once all deques exist, as they steal from each */
+	for (unsigned i = 0; i < nthreads; i++)
+		m_workers[i]->thread = std::thread(&WorkPool::run, this, i);
+}
+
+WorkPool::~WorkPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_idle_lock);
+		m_stopping = true;
+	}
+	m_idle.notify_all();
+
+	for (auto &worker : m_workers)
+		worker->thread.join();
+
+	m_app.del_fd(m_eventfd);
+	close(m_eventfd);
+}
+
+size_t
+WorkPool::size() const
+{
+	return m_workers.size();
+}
+
+void
+WorkPool::submit(work_t work, done_t done)
+{
+	/* work submitted from a worker goes to that worker's own deque */
+	size_t idx = t_pool == this ? t_self : m_next++ % m_workers.size();
+	Worker &worker = *m_workers[idx];
+
+	{
+		std::lock_guard<std::mutex> lock(worker.lock);
+		worker.tasks.push_back({ std::move(work), std::move(done) });
+	}
+	m_queued++;
+
+	/* taking the lock orders this against a worker about to sleep */
+	{
+		std::lock_guard<std::mutex> lock(m_idle_lock);
+	}
+	m_idle.notify_one();
+}
+
+bool
+WorkPool::take(size_t self, Task &task)
+{
+	size_t n = m_workers.size();
+
+	/* newest of our own first, as its data is likeliest to be cached */
+	{
+		Worker &own = *m_workers[self];
+		std::lock_guard<std::mutex> lock(own.lock);
+
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			m_queued--;
+			return true;
+		}
+	}
+
+	/* otherwise steal the oldest of another's */
+	for (size_t i = 1; i < n; i++) {
+		Worker &victim = *m_workers[(self + i) % n];
+		std::lock_guard<std::mutex> lock(victim.lock);
+
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			m_queued--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void
+WorkPool::run(size_t self)
+{
+	t_pool = this;
+	t_self = self;
+
+	for (;;) {
+		Task task;
+
+		if (take(self, task)) {
+			task.work();
+			post(std::move(task.done));
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_idle_lock);
+		m_idle.wait(lock, [this]() { return m_stopping || m_queued > 0; });
+		if (m_stopping)
+			return;
+	}
+}
+
+void
+WorkPool::post(done_t done)
+{
+	uint64_t one = 1;
+
+	m_completions.push(std::move(done));
+
+	/* only the first completion since the loop last drained need wake it */
+	if (!m_signalled.exchange(true))
+		(void)write(m_eventfd, &one, sizeof(one));
+}
+
+void
+WorkPool::drain(int fd)
+{
+	uint64_t count;
+	done_t done;
+
+	(void)read(fd, &count, sizeof(count));
+	/* cleared before popping, so a completion posted meanwhile rewakes us */
+	m_signalled.store(false);
+
+	while (m_completions.pop(done))
+		done();
+}
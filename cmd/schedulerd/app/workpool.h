@@ -0,0 +1,95 @@
+#ifndef WORKPOOL_H_
+#define WORKPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "iwng_compat/mpsc.h"
+
+class App;
+
+/**
+ * A pool of worker threads for CPU-bound and blocking work, so that the event
+ * loop stays responsive.
+ *
+ * Each worker has its own deque of tasks. A worker takes its most recently
+ * queued task first, and when its deque is empty, steals the oldest task of
+ * another worker. When a task's work is done, its completion callback is posted
+ * back to the loop thread through a lock-free queue. An eventfd watched by the
+ * loop is signalled only when that queue goes from empty to non-empty.
+ */
+class WorkPool {
+    public:
+	typedef std::function<void()> work_t; /**< run on a worker */
+	typedef std::function<void()> done_t; /**< run on the loop thread */
+
+	/** Create a pool; \p nthreads of 0 means one per online CPU. */
+	WorkPool(App &app, unsigned nthreads = 0);
+	~WorkPool();
+
+	/**
+	 * Run \p work on a worker, then \p done on the loop thread. May be
+	 * called from the loop thread or from within work on a worker.
+	 */
+	void submit(work_t work, done_t done);
+
+	/**
+	 * As submit(), but \p work returns a value, which is passed to \p done.
+	 */
+	template <typename R>
+	void submit(std::function<R()> work, std::function<void(R &)> done);
+
+	/** Number of worker threads. */
+	size_t size() const;
+
+    private:
+	struct Task {
+		work_t work;
+		done_t done;
+	};
+
+	/** A worker's deque. */
+	struct Worker {
+		std::mutex lock;
+		std::deque<Task> tasks;
+		std::thread thread;
+	};
+
+	App &m_app;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::atomic<size_t> m_queued { 0 }; /**< tasks not yet taken */
+	std::atomic<size_t> m_next { 0 };   /**< for round-robin submission */
+	std::mutex m_idle_lock;
+	std::condition_variable m_idle; /**< signalled as tasks are queued */
+	bool m_stopping = false;
+
+	int m_eventfd = -1;			 /**< signals completions */
+	std::atomic<bool> m_signalled { false }; /**< is #m_eventfd signalled? */
+	MPSCQueue<done_t> m_completions;	 /**< to run on the loop */
+
+	void run(size_t self);
+	/** Take a task, from \p self's deque or else by stealing. */
+	bool take(size_t self, Task &task);
+	/** Post a completion back to the loop thread. */
+	void post(done_t done);
+	/** Called on the loop thread when #m_eventfd is readable. */
+	void drain(int fd);
+};
+
+template <typename R>
+void
+WorkPool::submit(std::function<R()> work, std::function<void(R &)> done)
+{
+	auto result = std::make_shared<R>();
+
+	submit([work, result]() { *result = work(); },
+	    [done, result]() { done(*result); });
+}
+
+#endif /* WORKPOOL_H_ */
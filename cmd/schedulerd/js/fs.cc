@@ -9,7 +9,9 @@
 #include <list>
 #include <unistd.h>
 
+#include "../app/app.h"
 #include "js.h"
+#include "promise.h"
 #include "qjspp.h"
 #include "quickjs.h"
 
@@ -175,6 +177,60 @@ readSync(int64_t fd, qjs::Value buffer, int64_t offset, int64_t length,
 		return qjs::Value(ctx, nread);
 }
 
+/** Read a whole file; for the worker pool. */
+static int
+read_file(const std::string &path, std::vector<uint8_t> &data)
+{
+	uint8_t buf[16384];
+	ssize_t nread;
+	int fd;
+
+	fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY);
+	if (fd < 0)
+		return -errno;
+
+	while ((nread = read(fd, buf, sizeof(buf))) > 0)
+		data.insert(data.end(), buf, buf + nread);
+
+	close(fd);
+
+	return nread < 0 ? -errno : 0;
+}
+
+/** Read a whole file on the worker pool; returns a promise of its contents. */
+static qjs::Value
+readFile(qjs::Value opath)
+{
+	JSContext *ctx = opath.ctx;
+	JS &js = JS::from_ctx(ctx);
+	std::string path = opath.as<std::string>();
+	JSPromise *promise = JSPromise::create(*js.ctx).release();
+	qjs::Value result = promise->promCapability;
+	struct Read {
+		int err;
+		std::vector<uint8_t> data;
+	};
+	auto rd = std::make_shared<Read>();
+
+	js.m_app.m_pool.submit(
+	    [path, rd]() { rd->err = read_file(path, rd->data); },
+	    [ctx, promise, rd]() {
+		    if (rd->err < 0) {
+			    qjs::Value err(ctx, JS_NewError(ctx));
+
+			    err["message"] = std::string(strerror(-rd->err));
+			    err["errno"] = (int64_t)-rd->err;
+			    promise->reject(err);
+		    } else
+			    promise->resolve(qjs::Value(ctx,
+				JS_NewArrayBufferCopy(ctx, rd->data.data(),
+				    rd->data.size())));
+		    delete promise;
+	    });
+
+	return result;
+}
+
 static qjs::Value
 readdirSync(qjs::Value opath)
 {
@@ -204,6 +260,7 @@ setup_fs(qjs::Context *ctx)
 	mod.function<getLinkedNames>("getLinkedNames")
 	    .function<openSync>("openSync")
 	    .function<readSync>("readSync")
+	    .function<readFile>("readFile")
 	    .function<readdirSync>("readdirSync")
 	    .add("constants", constants);
 
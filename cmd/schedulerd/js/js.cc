@@ -2,6 +2,7 @@
 
 #include "../app/app.h"
 #include "js.h"
+#include "promise.h"
 #include "qjspp.h"
 
 struct JSTimer {
@@ -17,21 +18,6 @@ struct JSTimer {
 	void app_cb(App::timerid_t id, uintptr_t udata);
 };
 
-struct JSPromise {
-	qjs::Value fnOnFulfilled, fnOnRejected, promCapability;
-
-	static std::unique_ptr<JSPromise> create(qjs::Context &ctx);
-
-	JSPromise(qjs::Value &&promCapability, qjs::Value &&onFulfilled,
-	    qjs::Value &&onRejected)
-	    : fnOnFulfilled(std::move(onFulfilled))
-	    , fnOnRejected(std::move(onRejected))
-	    , promCapability(std::move(promCapability)) {};
-
-	void resolve(qjs::Value arg);
-	void reject(qjs::Value reason);
-};
-
 void setup_fs(qjs::Context *ctx);
 void setup_restarter(qjs::Context *ctx);
 void setup_sched(JS &js);
@@ -0,0 +1,24 @@
+#ifndef PROMISE_H_
+#define PROMISE_H_
+
+#include <memory>
+
+#include "qjspp.h"
+
+/** A promise, with the functions to settle it, for native code to settle. */
+struct JSPromise {
+	qjs::Value fnOnFulfilled, fnOnRejected, promCapability;
+
+	static std::unique_ptr<JSPromise> create(qjs::Context &ctx);
+
+	JSPromise(qjs::Value &&promCapability, qjs::Value &&onFulfilled,
+	    qjs::Value &&onRejected)
+	    : fnOnFulfilled(std::move(onFulfilled))
+	    , fnOnRejected(std::move(onRejected))
+	    , promCapability(std::move(promCapability)) {};
+
+	void resolve(qjs::Value arg);
+	void reject(qjs::Value reason);
+};
+
+#endif /* PROMISE_H_ */
@@ -1,4 +1,6 @@
+#include "../app/app.h"
 #include "../restarters/restarter.h"
+#include "js.h"
 #include "qjspp.h"
 
 class JSRestarter : public Restarter {
@@ -8,6 +10,16 @@ class JSRestarter : public Restarter {
 	JSRestarter(qjs::Value osched);
 	bool start(Transaction::Job::Id obj);
 	bool stop(Transaction::Job::Id obj);
+	void process_exited(Schedulable::SPtr object, pid_t pid, int code,
+	    int status);
+	void cgroup_empty(Schedulable::SPtr object);
+
+	/** Launch a process for an object; its exit calls processExited(). */
+	int64_t spawn(std::string object, std::vector<std::string> argv);
+	/** Signal a process launched by spawn(). */
+	int64_t kill(int64_t pid, int64_t signo);
+	/** Signal every process of an object's cgroup. */
+	int64_t killAll(std::string object, int64_t signo);
 };
 
 JSRestarter::JSRestarter(qjs::Value osched)
@@ -30,10 +42,95 @@ JSRestarter::stop(Transaction::Job::Id obj)
 	    .as<std::function<bool(int64_t)>>()(obj);
 }
 
+void
+JSRestarter::process_exited(Schedulable::SPtr object, pid_t pid, int code,
+    int status)
+{
+	JS &js = JS::from_ctx(ctx);
+	qjs::Value fun = qjs::Value(ctx, this)["processExited"];
+
+	if (!JS_IsFunction(ctx, fun.v))
+		return;
+
+	try {
+		std::function<void(std::string, int64_t, int64_t, int64_t)>
+		    cb = fun.as<std::function<void(std::string, int64_t,
+			int64_t, int64_t)>>();
+
+		cb(object->id().name, pid, code, status);
+	} catch (const qjs::exception &exc) {
+		js.log_exception(js.ctx);
+	}
+}
+
+void
+JSRestarter::cgroup_empty(Schedulable::SPtr object)
+{
+	JS &js = JS::from_ctx(ctx);
+	qjs::Value fun = qjs::Value(ctx, this)["cgroupEmpty"];
+
+	if (!JS_IsFunction(ctx, fun.v))
+		return;
+
+	try {
+		std::function<void(std::string)> cb =
+		    fun.as<std::function<void(std::string)>>();
+
+		cb(object->id().name);
+	} catch (const qjs::exception &exc) {
+		js.log_exception(js.ctx);
+	}
+}
+
+int64_t
+JSRestarter::spawn(std::string object, std::vector<std::string> argv)
+{
+	ObjectId id(object);
+	Schedulable *obj = sched.object_get(id);
+
+	return JS::from_ctx(ctx).m_app.m_procman.spawn(argv, this,
+	    obj->shared_from_this());
+}
+
+int64_t
+JSRestarter::kill(int64_t pid, int64_t signo)
+{
+	return JS::from_ctx(ctx).m_app.m_procman.kill(pid, signo);
+}
+
+int64_t
+JSRestarter::killAll(std::string object, int64_t signo)
+{
+	ObjectId id(object);
+	Schedulable *obj = sched.object_get(id);
+
+	return JS::from_ctx(ctx).m_app.m_procman.kill_all(
+	    obj->shared_from_this(), signo);
+}
+
+/**
+ * Register a restarter as the one in charge of objects of a type. The
+ * restarter is kept alive from then on.
+ */
+static void
+registerRestarter(std::string type, qjs::Value orestarter)
+{
+	JSRestarter *restarter = orestarter.as<JSRestarter *>();
+
+	JS::from_ctx(orestarter.ctx).m_app.restarter_register(type, restarter);
+	/* the app's restarter table now holds the reference */
+	orestarter.release();
+}
+
 void
 setup_restarter(qjs::Context *ctx)
 {
 	qjs::Context::Module &mod = ctx->addModule("@iw/restarter");
 
-	mod.class_<JSRestarter>("Restarter").constructor<qjs::Value>();
+	mod.class_<JSRestarter>("Restarter")
+	    .constructor<qjs::Value>()
+	    .fun<&JSRestarter::spawn>("spawn")
+	    .fun<&JSRestarter::kill>("kill")
+	    .fun<&JSRestarter::killAll>("killAll");
+	mod.function<registerRestarter>("registerRestarter");
 }
\ No newline at end of file
@@ -15,7 +15,11 @@ setup_sched(JS &js)
 		auto scheduler = mod.class_<Scheduler>("Scheduler");
 
 		scheduler.fun<&Scheduler::job_complete>("jobComplete")
-		    .fun<&Scheduler::object_load>("objectLoad");
+		    .fun<&Scheduler::object_load>("objectLoad")
+		    .fun<&Scheduler::set_job_limit>("setJobLimit")
+		    .fun<&Scheduler::set_restarter_job_limit>(
+			"setRestarterJobLimit")
+		    .fun<&Scheduler::history_write>("writeJobHistory");
 	}
 
 	mod.add("edgeTypes", edgeTypes);
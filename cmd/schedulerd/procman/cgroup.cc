@@ -0,0 +1,260 @@
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../app/app.h"
+#include "cgroup.h"
+
+/** Read the whole of a file, from its start. */
+static bool
+read_all(int fd, std::string &out)
+{
+	char buf[4096];
+	off_t off = 0;
+	ssize_t r;
+
+	out.clear();
+	while ((r = pread(fd, buf, sizeof(buf), off)) != 0) {
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		out.append(buf, r);
+		off += r;
+	}
+
+	return true;
+}
+
+CGroups::CGroups(App &app, const std::string &root)
+    : m_app(app)
+    , m_root(root)
+{
+	if (mkdir(root.c_str(), 0755) < 0 && errno != EEXIST) {
+		log_dbg("Can't make cgroup root %s: %s\n", root.c_str(),
+		    strerror(errno));
+		return;
+	}
+
+	m_rootfd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (m_rootfd < 0) {
+		log_dbg("Can't open cgroup root %s: %s\n", root.c_str(),
+		    strerror(errno));
+		return;
+	}
+
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify < 0 ||
+	    m_app.add_fd(m_inotify, POLLIN,
+		std::bind(&CGroups::inotify_ready, this,
+		    std::placeholders::_1)) < 0) {
+		log_dbg("Can't watch cgroups: %s\n", strerror(errno));
+		if (m_inotify >= 0)
+			close(m_inotify);
+		close(m_rootfd);
+		m_inotify = m_rootfd = -1;
+	}
+}
+
+CGroups::~CGroups()
+{
+	for (auto &it : m_groups) {
+		close(it.second.eventsfd);
+		close(it.second.dirfd);
+	}
+
+	if (m_inotify >= 0) {
+		m_app.del_fd(m_inotify);
+		close(m_inotify);
+	}
+	if (m_rootfd >= 0)
+		close(m_rootfd);
+}
+
+bool
+CGroups::enabled() const
+{
+	return m_rootfd >= 0;
+}
+
+CGroups::Group *
+CGroups::find(Schedulable::SPtr object)
+{
+	auto it = m_wds.find(object->id().name);
+
+	return it == m_wds.end() ? NULL : &m_groups[it->second];
+}
+
+int
+CGroups::open_procs(Schedulable::SPtr object, Restarter *owner)
+{
+	Group *group = find(object);
+	const std::string &name = object->id().name;
+	std::string events;
+	int dirfd, eventsfd, wd, fd;
+
+	if (!enabled())
+		return -ENOTSUP;
+
+	if (group == NULL) {
+		if (mkdirat(m_rootfd, name.c_str(), 0755) < 0 &&
+		    errno != EEXIST)
+			return -errno;
+
+		dirfd = openat(m_rootfd, name.c_str(),
+		    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (dirfd < 0)
+			return -errno;
+
+		eventsfd = openat(dirfd, "cgroup.events",
+		    O_RDONLY | O_CREAT | O_CLOEXEC, 0644);
+		if (eventsfd < 0) {
+			close(dirfd);
+			return -errno;
+		}
+
+		events = m_root + "/" + name + "/cgroup.events";
+		wd = inotify_add_watch(m_inotify, events.c_str(), IN_MODIFY);
+		if (wd < 0) {
+			int err = errno;
+
+			close(eventsfd);
+			close(dirfd);
+			return -err;
+		}
+
+		group = &m_groups[wd];
+		*group = { name, owner, object, dirfd, eventsfd, false };
+		m_wds[name] = wd;
+	} else
+		group->owner = owner;
+
+	fd = openat(group->dirfd, "cgroup.procs",
+	    O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+
+	return fd < 0 ? -errno : fd;
+}
+
+void
+CGroups::populated(Schedulable::SPtr object)
+{
+	Group *group = find(object);
+
+	if (group != NULL)
+		group->populated = true;
+}
+
+int
+CGroups::kill(Schedulable::SPtr object, int signo)
+{
+	Group *group = find(object);
+	std::string procs;
+	const char *p;
+	int fd;
+
+	if (group == NULL)
+		return -ENOENT;
+
+	/* the kernel can kill the whole cgroup, new forks and all, at once */
+	if (signo == SIGKILL) {
+		fd = openat(group->dirfd, "cgroup.kill", O_WRONLY | O_CLOEXEC);
+		if (fd >= 0 && write(fd, "1", 1) == 1) {
+			close(fd);
+			return 0;
+		} else if (fd >= 0)
+			close(fd);
+	}
+
+	fd = openat(group->dirfd, "cgroup.procs", O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	else if (!read_all(fd, procs)) {
+		int err = errno;
+
+		close(fd);
+		return -err;
+	}
+	close(fd);
+
+	for (p = procs.c_str(); *p != '\0';) {
+		char *end;
+		long pid = strtol(p, &end, 10);
+
+		if (end == p)
+			break;
+		if (pid > 0)
+			::kill(pid, signo);
+		p = end;
+	}
+
+	return 0;
+}
+
+void
+CGroups::remove(std::unordered_map<int, Group>::iterator it)
+{
+	Group &group = it->second;
+
+	inotify_rm_watch(m_inotify, it->first);
+	close(group.eventsfd);
+	close(group.dirfd);
+	/* fails harmlessly if processes were placed in it meanwhile */
+	unlinkat(m_rootfd, group.name.c_str(), AT_REMOVEDIR);
+
+	m_wds.erase(group.name);
+	m_groups.erase(it);
+}
+
+bool
+CGroups::update(Group &group)
+{
+	std::string events;
+	bool was = group.populated;
+	size_t pos;
+
+	if (!read_all(group.eventsfd, events))
+		return false;
+
+	pos = events.find("populated ");
+	if (pos == std::string::npos)
+		return false;
+
+	group.populated = events[pos + strlen("populated ")] == '1';
+
+	return was && !group.populated;
+}
+
+void
+CGroups::inotify_ready(int fd)
+{
+	alignas(struct inotify_event) char buf[4096];
+	ssize_t len;
+
+	while ((len = read(fd, buf, sizeof(buf))) > 0) {
+		struct inotify_event *ev;
+
+		for (char *p = buf; p < buf + len;
+		     p += sizeof(*ev) + ev->len) {
+			ev = (struct inotify_event *)p;
+
+			auto it = m_groups.find(ev->wd);
+			if (it == m_groups.end() || !update(it->second))
+				continue;
+
+			Restarter *owner = it->second.owner;
+			Schedulable::SPtr object = it->second.object;
+
+			log_trace("CGroup of %s emptied\n",
+			    object->id().name.c_str());
+			remove(it);
+			owner->cgroup_empty(object);
+		}
+	}
+}
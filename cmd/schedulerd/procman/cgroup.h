@@ -0,0 +1,81 @@
+#ifndef CGROUP_H_
+#define CGROUP_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "../scheduler/object.h"
+
+class App;
+class Restarter;
+
+/**
+ * Per-object cgroup v2 directories. The processes of an object are placed in
+ * its cgroup, so that they are tracked however they fork or daemonise.
+ *
+ * The kernel modifies a cgroup's cgroup.events file as the cgroup becomes
+ * populated or empty. These files are watched through a single inotify FD, so
+ * that the emptying of a cgroup is learnt of by one event rather than by
+ * polling. When an object's cgroup empties, the restarter in charge of it is
+ * told, and the cgroup removed.
+ *
+ * The cgroups are made under a root directory, ordinarily in the cgroup2
+ * filesystem. Any other directory may stand in for it, e.g. on a tmpfs, in
+ * which case cgroup.events is written by whoever plays the kernel's part.
+ */
+class CGroups {
+    public:
+	/** Use cgroups under \p root, which is made if it doesn't exist. */
+	CGroups(App &app, const std::string &root);
+	~CGroups();
+
+	/** Whether the root could be opened; if not, all else fails. */
+	bool enabled() const;
+
+	/**
+	 * Open the cgroup.procs file of an object's cgroup, for writing a PID
+	 * to, to place a process in it. The cgroup is made if need be, and
+	 * its emptying reported to \p owner.
+	 * @returns An FD, which the caller closes, or -errno.
+	 */
+	int open_procs(Schedulable::SPtr object, Restarter *owner);
+	/**
+	 * Note that an object's cgroup has been populated, e.g. by a process
+	 * placed in it, in case it empties before the event for its
+	 * population is handled.
+	 */
+	void populated(Schedulable::SPtr object);
+	/**
+	 * Send a signal to every process of an object's cgroup.
+	 * @returns 0, or -errno.
+	 */
+	int kill(Schedulable::SPtr object, int signo);
+
+    private:
+	/** An object's cgroup. */
+	struct Group {
+		std::string name; /**< directory name, that of the object */
+		Restarter *owner;
+		Schedulable::SPtr object;
+		int dirfd;
+		int eventsfd;	 /**< cgroup.events */
+		bool populated; /**< as last read from #eventsfd */
+	};
+
+	App &m_app;
+	std::string m_root;
+	int m_rootfd = -1;
+	int m_inotify = -1;
+	std::unordered_map<int, Group> m_groups;   /**< by inotify watch */
+	std::unordered_map<std::string, int> m_wds; /**< object name to watch */
+
+	Group *find(Schedulable::SPtr object);
+	/** Stop watching a cgroup, and remove it. */
+	void remove(std::unordered_map<int, Group>::iterator it);
+	/** Re-read the populated state of a cgroup; true if it emptied. */
+	bool update(Group &group);
+	/** Called when #m_inotify is readable. */
+	void inotify_ready(int fd);
+};
+
+#endif /* CGROUP_H_ */
@@ -0,0 +1,298 @@
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+
+#include "../app/app.h"
+#include "procman.h"
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+extern char **environ;
+
+/** Where cgroups are made, unless overridden by $SCHEDULERD_CGROUP_ROOT. */
+static const char *kCGroupRoot = "/sys/fs/cgroup/schedulerd";
+
+static std::string
+cgroup_root()
+{
+	const char *root = getenv("SCHEDULERD_CGROUP_ROOT");
+
+	return root != NULL ? root : kCGroupRoot;
+}
+
+ProcMan::ProcMan(App &app)
+    : m_app(app)
+    , m_cgroups(app, cgroup_root())
+{
+	m_app.add_signal(SIGCHLD,
+	    std::bind(&ProcMan::reap, this, std::placeholders::_1));
+}
+
+ProcMan::~ProcMan()
+{
+	for (auto &it : m_pids)
+		pidfd_unwatch(it.second);
+}
+
+int
+ProcMan::pidfd_watch(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+	/* an unreaped child's PID can't be reused, so this can't race */
+	int pidfd = syscall(SYS_pidfd_open, pid, 0);
+
+	if (pidfd < 0)
+		return -1; /* ENOSYS: fall back to SIGCHLD alone */
+
+	if (m_app.add_fd(pidfd, POLLIN,
+		std::bind(&ProcMan::pidfd_ready, this, pid,
+		    std::placeholders::_1)) < 0) {
+		close(pidfd);
+		return -1;
+	}
+
+	return pidfd;
+#else
+	return -1;
+#endif
+}
+
+void
+ProcMan::pidfd_unwatch(Watch &watch)
+{
+	if (watch.pidfd < 0)
+		return;
+
+	m_app.del_fd(watch.pidfd);
+	close(watch.pidfd);
+	watch.pidfd = -1;
+}
+
+pid_t
+ProcMan::spawn(const std::vector<std::string> &argv, Restarter *owner,
+    Schedulable::SPtr object)
+{
+	std::vector<char *> args;
+	posix_spawnattr_t attr;
+	sigset_t mask;
+	pid_t pid;
+	int r, procsfd;
+
+	if (argv.empty())
+		return -EINVAL;
+
+	for (auto &arg : argv)
+		args.push_back((char *)arg.c_str());
+	args.push_back(NULL);
+
+	if (m_cgroups.enabled()) {
+		procsfd = m_cgroups.open_procs(object, owner);
+		if (procsfd >= 0) {
+			pid = spawn_in_cgroup(args.data(), procsfd);
+			close(procsfd);
+			if (pid < 0)
+				return pid;
+
+			m_cgroups.populated(object);
+			watch(pid, owner, object);
+			return pid;
+		}
+
+		log_dbg("Can't place process of %s in a cgroup: %s\n",
+		    object->id().name.c_str(), strerror(-procsfd));
+	}
+
+	/* the loop blocks the signals it watches; the child mustn't inherit */
+	sigemptyset(&mask);
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setsigmask(&attr, &mask);
+	sigaddset(&mask, SIGCHLD);
+	posix_spawnattr_setsigdefault(&attr, &mask);
+	posix_spawnattr_setflags(&attr,
+	    POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+	r = posix_spawnp(&pid, args[0], NULL, &attr, args.data(), environ);
+	posix_spawnattr_destroy(&attr);
+	if (r != 0)
+		return -r;
+
+	watch(pid, owner, object);
+
+	return pid;
+}
+
+pid_t
+ProcMan::spawn_in_cgroup(char *const *args, int procsfd)
+{
+	int pipefd[2], err;
+	sigset_t mask;
+	pid_t pid;
+	ssize_t r;
+
+	/* the child reports a failure to execute through this; EOF if none */
+	if (pipe2(pipefd, O_CLOEXEC) < 0)
+		return -errno;
+
+	sigemptyset(&mask);
+
+	pid = fork();
+	if (pid < 0) {
+		err = errno;
+		close(pipefd[0]);
+		close(pipefd[1]);
+		return -err;
+	} else if (pid == 0) {
+		/* only async-signal-safe calls from here on */
+		char buf[16], *p = buf + sizeof(buf);
+		pid_t self = getpid();
+
+		do
+			*--p = '0' + self % 10;
+		while ((self /= 10) > 0);
+
+		/* before executing, so that no descendant escapes the cgroup */
+		if (write(procsfd, p, buf + sizeof(buf) - p) >= 0) {
+			signal(SIGCHLD, SIG_DFL);
+			sigprocmask(SIG_SETMASK, &mask, NULL);
+			execvp(args[0], args);
+		}
+
+		err = errno;
+		(void)write(pipefd[1], &err, sizeof(err));
+		_exit(127);
+	}
+
+	close(pipefd[1]);
+	while ((r = read(pipefd[0], &err, sizeof(err))) < 0 && errno == EINTR)
+		;
+	close(pipefd[0]);
+
+	if (r == sizeof(err)) {
+		waitpid(pid, NULL, 0);
+		return -err;
+	}
+
+	return pid;
+}
+
+void
+ProcMan::watch(pid_t pid, Restarter *owner, Schedulable::SPtr object)
+{
+	auto it = m_pids.find(pid);
+
+	if (it != m_pids.end()) {
+		it->second.owner = owner;
+		it->second.object = object;
+		return;
+	}
+
+	m_pids[pid] = { owner, object, pidfd_watch(pid) };
+}
+
+void
+ProcMan::unwatch(pid_t pid)
+{
+	auto it = m_pids.find(pid);
+
+	if (it == m_pids.end())
+		return;
+
+	pidfd_unwatch(it->second);
+	m_pids.erase(it);
+}
+
+int
+ProcMan::kill(pid_t pid, int signo)
+{
+	auto it = m_pids.find(pid);
+	int r;
+
+	if (it == m_pids.end())
+		return -ESRCH;
+
+#ifdef SYS_pidfd_send_signal
+	if (it->second.pidfd >= 0)
+		r = syscall(SYS_pidfd_send_signal, it->second.pidfd, signo, NULL,
+		    0);
+	else
+#endif
+		r = ::kill(pid, signo);
+
+	return r < 0 ? -errno : 0;
+}
+
+int
+ProcMan::kill_all(Schedulable::SPtr object, int signo)
+{
+	return m_cgroups.kill(object, signo);
+}
+
+void
+ProcMan::exited(std::unordered_map<pid_t, Watch>::iterator it,
+    const siginfo_t &si)
+{
+	Watch watch = std::move(it->second);
+
+	m_pids.erase(it);
+	pidfd_unwatch(watch);
+	watch.owner->process_exited(watch.object, si.si_pid, si.si_code,
+	    si.si_status);
+}
+
+void
+ProcMan::pidfd_ready(pid_t pid, int pidfd)
+{
+	auto it = m_pids.find(pid);
+	siginfo_t si;
+
+	if (it == m_pids.end() || it->second.pidfd != pidfd)
+		return;
+
+	si.si_pid = 0;
+	while (waitid((idtype_t)P_PIDFD, pidfd, &si, WEXITED | WNOHANG) < 0)
+		if (errno != EINTR)
+			return;
+	if (si.si_pid == 0)
+		return; /* spurious */
+
+	exited(it, si);
+}
+
+void
+ProcMan::reap(int signo)
+{
+	for (;;) {
+		siginfo_t si;
+
+		si.si_pid = 0;
+		if (waitid(P_ALL, 0, &si, WEXITED | WNOHANG) < 0) {
+			if (errno == EINTR)
+				continue;
+			break; /* ECHILD: no children left */
+		} else if (si.si_pid == 0)
+			break; /* none (more) exited */
+
+		/*
+		 * A watched process may be reaped here before its pidfd's
+		 * event is handled; exited() unwatches the pidfd, so that
+		 * event is dropped.
+		 */
+		auto it = m_pids.find(si.si_pid);
+		if (it == m_pids.end()) {
+			/* e.g. an orphan reparented to us */
+			log_trace("Reaped unwatched process %d\n", si.si_pid);
+			continue;
+		}
+
+		exited(it, si);
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef PROCMAN_H_
+#define PROCMAN_H_
+
+#include <sys/types.h>
+
+#include <csignal>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../scheduler/object.h"
+#include "cgroup.h"
+
+class App;
+class Restarter;
+
+/**
+ * The process manager. Launches processes on behalf of restarters, and routes
+ * the exit of each to the restarter in charge of the object it belongs to.
+ *
+ * Each watched process is held by a pidfd, where the kernel supports them.
+ * The pidfd is watched by the loop, so that the exit of each process is an
+ * event of its own, and its status is collected and signals sent through the
+ * pidfd, which can't come to refer to another process as a PID can once the
+ * process is reaped.
+ *
+ * SIGCHLD is still handled, as orphans reparented to us must be reaped, and
+ * processes without a pidfd are learnt of by it. Signals coalesce, so one
+ * delivery may stand for many exits; every exited child is therefore reaped
+ * on each delivery, so that e.g. the exits of a mass stop are handled in a
+ * single loop pass.
+ *
+ * Where cgroups are available, each process launched is placed in its
+ * object's cgroup before it executes, so that its descendants are tracked
+ * too, and the restarter told when the last of them has exited.
+ */
+class ProcMan {
+    public:
+	ProcMan(App &app);
+	~ProcMan();
+
+	/**
+	 * Launch a process for \p object, whose exit is to be reported to
+	 * \p owner.
+	 * @returns The PID of the process, or -errno.
+	 */
+	pid_t spawn(const std::vector<std::string> &argv, Restarter *owner,
+	    Schedulable::SPtr object);
+	/** Report the exit of an existing child to \p owner. */
+	void watch(pid_t pid, Restarter *owner, Schedulable::SPtr object);
+	/** Stop reporting the exit of a process; it is still reaped. */
+	void unwatch(pid_t pid);
+	/**
+	 * Send a signal to a watched process. Sent through its pidfd if it has
+	 * one.
+	 * @returns 0, or -errno.
+	 */
+	int kill(pid_t pid, int signo);
+	/**
+	 * Send a signal to every process of an object's cgroup.
+	 * @returns 0, or -errno.
+	 */
+	int kill_all(Schedulable::SPtr object, int signo);
+
+    private:
+	/** Whom a process's exit is reported to. */
+	struct Watch {
+		Restarter *owner;
+		Schedulable::SPtr object;
+		int pidfd; /**< -1 if none */
+	};
+
+	App &m_app;
+	CGroups m_cgroups;
+	std::unordered_map<pid_t, Watch> m_pids; /**< processes watched */
+
+	/**
+	 * Launch a process, first placing it in a cgroup by writing its PID to
+	 * \p procsfd.
+	 * @returns The PID of the process, or -errno.
+	 */
+	pid_t spawn_in_cgroup(char *const *args, int procsfd);
+
+	/** Open a pidfd for a process, and watch it; -1 if unsupported. */
+	int pidfd_watch(pid_t pid);
+	/** Stop watching a process's pidfd, and close it. */
+	void pidfd_unwatch(Watch &watch);
+	/** Called when a process's pidfd is readable, i.e. it has exited. */
+	void pidfd_ready(pid_t pid, int pidfd);
+	/** Report the exit of a watched process, and forget it. */
+	void exited(std::unordered_map<pid_t, Watch>::iterator it,
+	    const siginfo_t &si);
+
+	/** Reap every child which has exited. */
+	void reap(int signo);
+};
+
+#endif /* PROCMAN_H_ */
@@ -3,14 +3,17 @@
 bool
 TargetRestarter::start(Transaction::Job::Id id)
 {
+	sched.object_set_state(sched.job_get(id)->object->id(),
+	    Schedulable::kOnline);
 	sched.job_complete(id, Transaction::Job::kSuccess);
-	// sched.object_set_state(, Schedulable::State state)
 	return 0;
 }
 
 bool
 TargetRestarter::stop(Transaction::Job::Id id)
 {
+	sched.object_set_state(sched.job_get(id)->object->id(),
+	    Schedulable::kOffline);
 	sched.job_complete(id, Transaction::Job::kSuccess);
 	return 0;
 }
@@ -14,6 +14,18 @@ class Restarter {
 	bool start_job(Transaction::Job::Id job, Transaction::JobType type);
 	virtual bool start(Transaction::Job::Id obj) = 0;
 	virtual bool stop(Transaction::Job::Id obj) = 0;
+	/**
+	 * Called when a process launched or watched for \p object through the
+	 * process manager has exited. \p code and \p status are as the
+	 * si_code and si_status fields of a siginfo_t from waitid().
+	 */
+	virtual void process_exited(Schedulable::SPtr object, pid_t pid,
+	    int code, int status) {};
+	/**
+	 * Called when the last process in \p object's cgroup has exited,
+	 * including any forked off by the processes launched for it.
+	 */
+	virtual void cgroup_empty(Schedulable::SPtr object) {};
 };
 
 class TargetRestarter : public Restarter {
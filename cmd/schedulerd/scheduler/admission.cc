@@ -0,0 +1,166 @@
+#include <unistd.h>
+
+#include <cassert>
+
+#include "scheduler.h"
+
+Admission::Admission()
+{
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+	m_limit = (ncpu > 0 ? ncpu : 1) * kJobsPerCPU;
+}
+
+void
+Admission::set_limit(unsigned limit)
+{
+	m_limit = limit;
+}
+
+Admission::Class &
+Admission::get_class(size_t type)
+{
+	if (type >= m_classes.size())
+		m_classes.resize(type + 1);
+	return m_classes[type];
+}
+
+void
+Admission::set_limit(size_t type, unsigned limit)
+{
+	get_class(type).limit = limit;
+}
+
+void
+Admission::set_start_limit(unsigned limit)
+{
+	m_start_limit = limit;
+}
+
+unsigned
+Admission::start_limit() const
+{
+	return m_start_limit;
+}
+
+unsigned
+Admission::limit() const
+{
+	return m_limit;
+}
+
+bool
+Admission::busy() const
+{
+	return m_running > 0 || !m_rr.empty();
+}
+
+bool
+Admission::waiting() const
+{
+	return !m_rr.empty();
+}
+
+bool
+Admission::is_start(Transaction::Job *job)
+{
+	return among(job->type,
+	    { Transaction::kStart, Transaction::kRestart,
+		Transaction::kReloadOrStart, Transaction::kRestartOrStart });
+}
+
+bool
+Admission::slot_free(Class &cls, Transaction::Job *job) const
+{
+	if (m_limit != 0 && m_running >= m_limit)
+		return false;
+	else if (cls.limit != 0 && cls.running >= cls.limit)
+		return false;
+	else if (m_start_limit != 0 && is_start(job) &&
+	    m_running_starts >= m_start_limit)
+		return false;
+	return true;
+}
+
+void
+Admission::take(Class &cls, Transaction::Job *job)
+{
+	cls.running++;
+	m_running++;
+	if (is_start(job))
+		m_running_starts++;
+}
+
+bool
+Admission::admit(size_t type, Transaction::Job *job)
+{
+	Class &cls = get_class(type);
+
+	/* don't overtake jobs of the same type already waiting */
+	if (cls.waiting.empty() && slot_free(cls, job)) {
+		take(cls, job);
+		return true;
+	}
+
+	if (cls.waiting.empty())
+		m_rr.push_back(type);
+	m_queued[job] = cls.waiting.insert(cls.waiting.end(), job);
+
+	return false;
+}
+
+void
+Admission::withdraw(size_t type, Transaction::Job *job)
+{
+	Class &cls = get_class(type);
+	auto it = m_queued.find(job);
+
+	assert(it != m_queued.end());
+	cls.waiting.erase(it->second);
+	m_queued.erase(it);
+
+	if (cls.waiting.empty())
+		m_rr.remove(type);
+}
+
+void
+Admission::release(size_t type, Transaction::Job *job)
+{
+	Class &cls = get_class(type);
+
+	assert(cls.running > 0 && m_running > 0);
+	cls.running--;
+	m_running--;
+	if (is_start(job)) {
+		assert(m_running_starts > 0);
+		m_running_starts--;
+	}
+}
+
+Transaction::Job *
+Admission::next()
+{
+	/* visit each class with waiting jobs at most once, in turn */
+	for (size_t n = m_rr.size(); n > 0; n--) {
+		size_t type = m_rr.front();
+		Class &cls = m_classes[type];
+		Transaction::Job *job = cls.waiting.front();
+
+		m_rr.pop_front();
+
+		if (!slot_free(cls, job)) {
+			m_rr.push_back(type);
+			continue;
+		}
+
+		cls.waiting.pop_front();
+		m_queued.erase(job);
+		if (!cls.waiting.empty())
+			m_rr.push_back(type);
+
+		take(cls, job);
+		return job;
+	}
+
+	return NULL;
+}
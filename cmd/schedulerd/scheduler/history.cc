@@ -0,0 +1,87 @@
+#include <sstream>
+
+#include "history.h"
+
+JobHistory::JobHistory(size_t size)
+    : m_ring(size)
+{
+}
+
+void
+JobHistory::push(JobRecord &&record)
+{
+	m_ring[m_next] = std::move(record);
+	m_next = (m_next + 1) % m_ring.size();
+	if (m_count < m_ring.size())
+		m_count++;
+}
+
+size_t
+JobHistory::size() const
+{
+	return m_count;
+}
+
+const JobRecord &
+JobHistory::at(size_t idx) const
+{
+	return m_ring[(m_next + m_ring.size() - m_count + idx) % m_ring.size()];
+}
+
+void
+JobHistory::clear()
+{
+	m_next = m_count = 0;
+}
+
+void
+JobHistory::write(std::ostream &out) const
+{
+	for (size_t i = 0; i < m_count; i++) {
+		const JobRecord &rec = at(i);
+
+		out << "job\t" << rec.id << "\t" << rec.object << "\t"
+		    << rec.type << "\t" << rec.state << "\t" << rec.enqueued
+		    << "\t" << rec.runnable << "\t" << rec.dispatched << "\t"
+		    << rec.completed << "\t";
+
+		if (rec.after.empty())
+			out << "-";
+		for (size_t j = 0; j < rec.after.size(); j++)
+			out << (j ? "," : "") << rec.after[j];
+
+		out << "\n";
+	}
+}
+
+bool
+JobHistory::read(std::istream &in, std::vector<JobRecord> &records)
+{
+	std::string line;
+
+	while (std::getline(in, line)) {
+		std::istringstream fields(line);
+		std::string tag, after, name;
+		JobRecord rec;
+
+		if (line.empty())
+			continue;
+
+		if (!(fields >> tag >> rec.id >> rec.object >> rec.type >>
+			rec.state >> rec.enqueued >> rec.runnable >>
+			rec.dispatched >> rec.completed >> after) ||
+		    tag != "job")
+			return false;
+
+		if (after != "-") {
+			std::istringstream names(after);
+
+			while (std::getline(names, name, ','))
+				rec.after.push_back(name);
+		}
+
+		records.push_back(std::move(rec));
+	}
+
+	return true;
+}
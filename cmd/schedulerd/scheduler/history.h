@@ -0,0 +1,66 @@
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * The record of one job's lifecycle. Timestamps are microseconds on the
+ * monotonic clock, or 0 if the job never reached that point.
+ */
+struct JobRecord {
+	int64_t id = -1;	 /**< job ID */
+	std::string object;	 /**< main name of the object */
+	std::string type;	 /**< job type, e.g. "start" */
+	std::string state;	 /**< final state, e.g. "success" */
+	uint64_t enqueued = 0;	 /**< its transaction was enqueued */
+	uint64_t runnable = 0;	 /**< no longer held back by ordering */
+	uint64_t dispatched = 0; /**< issued to the restarter */
+	uint64_t completed = 0;	 /**< completed or cancelled */
+	/** Objects with jobs in the transaction that this was ordered after. */
+	std::vector<std::string> after;
+};
+
+/**
+ * A fixed-size ring buffer of the records of completed jobs. Once full, each
+ * new record displaces the oldest.
+ *
+ * The history is written and read as text, one record per line, with fields
+ * separated by tabs:
+ *
+ *	job ID OBJECT TYPE STATE ENQUEUED RUNNABLE DISPATCHED COMPLETED AFTER
+ *
+ * where AFTER is a comma-separated list of object names, or "-" if empty.
+ */
+class JobHistory {
+    public:
+	static constexpr size_t kDefaultSize = 4096;
+
+	JobHistory(size_t size = kDefaultSize);
+
+	/** Add a record, displacing the oldest if the buffer is full. */
+	void push(JobRecord &&record);
+	/** Number of records held. */
+	size_t size() const;
+	/** Get a record; 0 is the oldest held. */
+	const JobRecord &at(size_t idx) const;
+	/** Discard all records. */
+	void clear();
+
+	/** Write all records held, oldest first. */
+	void write(std::ostream &out) const;
+	/**
+	 * Read records as written by write(), appending them to \p records.
+	 * @retval false A malformed line was found.
+	 */
+	static bool read(std::istream &in, std::vector<JobRecord> &records);
+
+    private:
+	std::vector<JobRecord> m_ring;
+	size_t m_next = 0;  /**< where the next record goes */
+	size_t m_count = 0; /**< number of records held */
+};
+
+#endif /* HISTORY_H_ */
@@ -0,0 +1,139 @@
+/*
+ * The event-based impurity.
+ *
+ * Objects may change state other than by the running of a job, e.g. when a
+ * device appears or a service exits. The post-facto and event edges of objects
+ * which change state call for jobs to be run in response. The impurity gathers
+ * up every state change notified within an event loop iteration and generates a
+ * single pseudotransaction containing all the jobs these call for, so that a
+ * flapping device or a mass stop produces one transaction rather than one per
+ * event.
+ */
+
+#include <iostream>
+
+#include "../app/app.h"
+#include "scheduler.h"
+
+int
+Scheduler::object_set_state(const ObjectId &id, Schedulable::State state)
+{
+	auto it = m_aliases.find(id);
+	Schedulable::SPtr obj;
+	Transaction::Job *job = NULL;
+	bool expected;
+
+	if (it == m_aliases.end())
+		return -ENOENT;
+
+	obj = it->second;
+	if (obj->state == state)
+		return 0;
+
+	/* changes brought about by a running job are expected */
+	if (!transactions.empty())
+		job = transactions.front()->object_job_for(obj);
+	expected = job != NULL && job->state == Transaction::Job::kRunning;
+
+	auto idx = m_state_change_idx.find(obj.get());
+	if (idx == m_state_change_idx.end()) {
+		m_state_change_idx[obj.get()] = m_state_changes.size();
+		m_state_changes.push_back({ obj, obj->state, state, expected });
+	} else {
+		/* coalesce with earlier changes within this iteration */
+		StateChange &change = m_state_changes[idx->second];
+		change.to = state;
+		change.expected = change.expected && expected;
+	}
+
+	obj->state = state;
+
+	return 0;
+}
+
+bool
+Scheduler::state_changes_pending() const
+{
+	return !m_state_changes.empty();
+}
+
+void
+Scheduler::dispatch_state_changes()
+{
+	std::vector<StateChange> changes;
+	std::unique_ptr<Transaction> tx;
+
+	if (m_state_changes.empty())
+		return;
+
+	changes.swap(m_state_changes);
+	m_state_change_idx.clear();
+	tx = std::make_unique<Transaction>(*this);
+
+	for (auto &change : changes) {
+		bool was_up, started, stopped, failed;
+
+		was_up = among(change.from,
+		    { Schedulable::kStarting, Schedulable::kOnline,
+			Schedulable::kStopping });
+		started = change.to == Schedulable::kOnline &&
+		    change.from != Schedulable::kOnline;
+		stopped = was_up &&
+		    among(change.to,
+			{ Schedulable::kOffline, Schedulable::kMaintenance });
+		failed = change.to == Schedulable::kMaintenance &&
+		    change.from != Schedulable::kMaintenance;
+
+		if (change.from == change.to)
+			continue; /* net change is nil */
+
+		for (auto &edge : change.object->edges) {
+			Edge::Type type = edge->type;
+
+			if (started && !change.expected) {
+				if (type & Edge::kStartOnStarted)
+					tx->job_submit(edge->to,
+					    Transaction::kStart);
+				if (type & Edge::kTryStartOnStarted) {
+					Transaction::Job *pending = NULL;
+
+					/* don't reverse an upcoming stop job */
+					if (!transactions.empty())
+						pending = transactions.front()
+							      ->object_job_for(
+								  edge->to);
+					if (pending == NULL ||
+					    pending->type != Transaction::kStop)
+						tx->job_submit(edge->to,
+						    Transaction::kStart);
+				}
+				if (type & Edge::kStopOnStarted)
+					tx->job_submit(edge->to,
+					    Transaction::kStop);
+			}
+
+			if (stopped && !change.expected &&
+			    type & Edge::kStopOnStopped)
+				tx->job_submit(edge->to, Transaction::kStop);
+
+			if (stopped && change.to == Schedulable::kOffline &&
+			    type & Edge::kOnSuccess)
+				tx->job_submit(edge->to, Transaction::kStart);
+
+			if (failed && type & Edge::kOnFailure)
+				tx->job_submit(edge->to, Transaction::kStart);
+		}
+	}
+
+	if (tx->empty())
+		return;
+
+	try {
+		tx->prepare();
+	} catch (const char *err) {
+		std::cout << "Dropping pseudotransaction: " << err << "\n";
+		return;
+	}
+
+	tx_push(std::move(tx));
+}
@@ -27,6 +27,9 @@ struct ObjectId {
 	ObjectId(const char *name)
 	    : name(name) {};
 
+	/** The object type, e.g. "service", as given by the name's suffix. */
+	std::string type() const;
+
 	bool operator==(const ObjectId &other) const;
 	bool operator==(const std::shared_ptr<Schedulable> &obj) const;
 };
@@ -202,6 +205,7 @@ class Schedulable : public std::enable_shared_from_this<Schedulable> {
 
     public:
 	State state = kUninitialised;
+	size_t restarter = 0; /**< index of restarter type in charge of this */
 
 	Schedulable(std::string name)
 	    : main_alias(name)
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "iwng_compat/misc_cxx.h"
+#include "psi.h"
+
+static const char *const psi_paths[PSI::kMax] = {
+	[PSI::kCPU] = "/proc/pressure/cpu",
+	[PSI::kIO] = "/proc/pressure/io",
+	[PSI::kMemory] = "/proc/pressure/memory",
+};
+
+PSI::PSI()
+{
+	for (int i = 0; i < kMax; i++)
+		m_fds[i] = open(psi_paths[i], O_RDONLY | O_CLOEXEC);
+
+	/* prime the totals so the first sample covers a real interval */
+	sample();
+}
+
+PSI::~PSI()
+{
+	for (int i = 0; i < kMax; i++)
+		if (m_fds[i] >= 0)
+			close(m_fds[i]);
+}
+
+bool
+PSI::available() const
+{
+	for (int i = 0; i < kMax; i++)
+		if (m_fds[i] >= 0)
+			return true;
+	return false;
+}
+
+int
+PSI::read_total(Resource res, uint64_t &total)
+{
+	char buf[256];
+	const char *line;
+	ssize_t len;
+
+	if (m_fds[res] < 0)
+		return -ENOENT;
+
+	len = pread(m_fds[res], buf, sizeof(buf) - 1, 0);
+	if (len < 0)
+		return -errno;
+	buf[len] = '\0';
+
+	/* format: some avg10=0.00 avg60=0.00 avg300=0.00 total=0 */
+	if (strncmp(buf, "some ", 5) != 0 ||
+	    (line = strstr(buf, "total=")) == NULL ||
+	    sscanf(line, "total=%" SCNu64, &total) != 1)
+		return -EINVAL;
+
+	return 0;
+}
+
+int
+PSI::sample()
+{
+	uint64_t now = monotonic_usec(), interval = now - m_when;
+	int worst = -1;
+
+	for (int i = 0; i < kMax; i++) {
+		uint64_t total;
+		int pct;
+
+		if (read_total((Resource)i, total) < 0)
+			continue;
+
+		if (m_when != 0 && interval > 0 && total >= m_total[i]) {
+			pct = std::min<uint64_t>(100,
+			    (total - m_total[i]) * 100 / interval);
+			if (pct > worst)
+				worst = pct;
+		}
+		m_total[i] = total;
+	}
+
+	m_when = now;
+
+	return worst;
+}
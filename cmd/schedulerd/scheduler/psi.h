@@ -0,0 +1,42 @@
+#ifndef PSI_H_
+#define PSI_H_
+
+#include <cstdint>
+
+/**
+ * Sampler for Linux pressure-stall information.
+ *
+ * Reads the cumulative "some" stall time from /proc/pressure/{cpu,io,memory}
+ * and yields, for each sample, the share of wall-clock time since the previous
+ * sample during which some task stalled on that resource.
+ */
+class PSI {
+    public:
+	enum Resource {
+		kCPU,
+		kIO,
+		kMemory,
+		kMax,
+	};
+
+	PSI();
+	~PSI();
+
+	/** Is pressure-stall information available on this system? */
+	bool available() const;
+	/**
+	 * Take a sample. Returns the worst pressure over all resources since
+	 * the previous sample as a percentage, or -1 if none is available.
+	 */
+	int sample();
+
+    private:
+	int m_fds[kMax];	     /**< open pressure files; -1 if absent */
+	uint64_t m_total[kMax] = {}; /**< stall totals at last sample, usec */
+	uint64_t m_when = 0;	     /**< time of last sample, usec */
+
+	/** Read the cumulative "some" stall total for a resource. */
+	int read_total(Resource res, uint64_t &total);
+};
+
+#endif /* PSI_H_ */
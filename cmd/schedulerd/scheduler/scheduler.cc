@@ -1,4 +1,7 @@
 #include <cassert>
+#include <cerrno>
+#include <cinttypes>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -14,6 +17,15 @@ Schedulable::id() const
 	return main_alias;
 }
 
+std::string
+ObjectId::type() const
+{
+	size_t dot = name.rfind('.');
+
+	/* as with systemd, a name without a suffix names a service */
+	return dot == std::string::npos ? "service" : name.substr(dot + 1);
+}
+
 bool
 ObjectId::operator==(const ObjectId &other) const
 {
@@ -26,6 +38,15 @@ ObjectId::operator==(const Schedulable::SPtr &obj) const
 	return obj->aliases.find(*this) != obj->aliases.end();
 }
 
+Scheduler::Scheduler(App &app)
+    : app(app)
+{
+	/* with pressure feedback, start from one start job per CPU and adapt */
+	if (m_psi.available())
+		m_admission.set_start_limit(
+		    m_admission.limit() / Admission::kJobsPerCPU);
+}
+
 void
 Scheduler::dispatch_load_queue()
 {
@@ -48,6 +69,7 @@ Scheduler::object_add(ObjectId id, Schedulable::SPtr obj)
 	assert(objects.find(obj) == objects.end());
 	assert(m_aliases.find(id) == m_aliases.end() ||
 	    m_aliases.find(id)->second == obj);
+	obj->restarter = app.restarter_index(obj->id().type());
 	objects.emplace(obj);
 	m_aliases[id] = obj;
 
@@ -67,17 +89,117 @@ Scheduler::edge_add(Edge::Type type, ObjectId owner, ObjectId from, ObjectId to)
 	return ofrom->edges.back().get();
 }
 
+void
+Scheduler::set_job_limit(unsigned limit)
+{
+	m_admission.set_limit(limit);
+	job_admit_queued();
+}
+
+void
+Scheduler::set_restarter_job_limit(std::string type, unsigned limit)
+{
+	m_admission.set_limit(app.restarter_index(type), limit);
+	job_admit_queued();
+}
+
+size_t
+Scheduler::job_restarter_type(Transaction::Job *job)
+{
+	return job->object->restarter;
+}
+
+void
+Scheduler::psi_arm()
+{
+	if (!m_psi.available() || m_psi_timer != 0)
+		return;
+
+	m_psi_timer = app.add_timer(false, kPSIIntervalMs,
+	    std::bind(&Scheduler::psi_timer_cb, this, std::placeholders::_1,
+		std::placeholders::_2));
+}
+
+void
+Scheduler::psi_timer_cb(Evloop::timerid_t id, uintptr_t udata)
+{
+	int pressure = m_psi.sample();
+	unsigned limit = m_admission.start_limit(), max = m_admission.limit();
+
+	m_psi_timer = 0;
+
+	if (pressure >= kPSIHigh)
+		limit = std::max(kPSIMinStarts, limit * 3 / 4);
+	else if (pressure >= 0 && pressure < kPSILow && m_admission.waiting())
+		limit += std::max(1u, limit / 4);
+
+	if (max != 0 && limit > max)
+		limit = max;
+
+	if (limit != m_admission.start_limit()) {
+#ifdef JOBSCHED_TRACE
+		std::cout << "Pressure " << pressure << "%: start job limit now "
+			  << limit << "\n";
+#endif
+		m_admission.set_start_limit(limit);
+		job_admit_queued();
+	}
+
+	if (m_admission.busy())
+		psi_arm();
+}
+
 int
 Scheduler::job_run(Transaction::Job *job)
 {
+	job->times.runnable = monotonic_usec();
+	psi_arm();
+
+	if (!m_admission.admit(job_restarter_type(job), job)) {
+#ifdef JOBSCHED_TRACE
+		std::cout << "Job " << *job << " awaits an admission slot\n";
+#endif
+		job->state = Transaction::Job::kQueued;
+		return false;
+	}
+
+	return job_dispatch(job);
+}
+
+void
+Scheduler::job_admit_queued()
+{
+	Transaction::Job *job;
+
+	while ((job = m_admission.next()) != NULL)
+		job_dispatch(job);
+}
+
+int
+Scheduler::job_dispatch(Transaction::Job *job)
+{
+	Restarter *restarter;
+
 	if (job->type == Transaction::kStart)
 		std::cout << "Starting " << job->object->id().name << "\n";
-	running_jobs[job->id] = job;
+	job->state = Transaction::Job::kRunning;
+	job->times.dispatched = monotonic_usec();
+	job->id = running_jobs.insert(job);
 	job->timer = app.add_timer(false, 700 /* JOB TIMEOUT MSEC */,
 	    std::bind(&Scheduler::job_timeout_cb, this, std::placeholders::_1,
 		std::placeholders::_2),
 	    job->id);
-	app.restarters["target"]->start(job->id);
+
+	restarter = app.restarters[job_restarter_type(job)];
+	if (restarter == NULL) {
+		log_dbg("No restarter for object %s\n",
+		    job->object->id().name.c_str());
+		job_complete(job->id, Transaction::Job::State::kFailure);
+	} else if (job->type == Transaction::kStop)
+		restarter->stop(job->id);
+	else
+		restarter->start(job->id);
+
 	return true;
 }
 
@@ -85,11 +207,22 @@ void
 Scheduler::job_timeout_cb(Evloop::timerid_t id, uintptr_t udata)
 {
 	Transaction::Job::Id jid = udata;
+	Transaction::Job *job = job_get(jid);
+
+	if (job == NULL)
+		return;
 
-	running_jobs[jid]->timer = 0;
+	job->timer = 0;
 	job_complete(jid, Transaction::Job::State::kTimeout);
 }
 
+Transaction::Job *
+Scheduler::job_get(Transaction::Job::Id id)
+{
+	Transaction::Job **job = running_jobs.get(id);
+	return job == NULL ? NULL : *job;
+}
+
 bool
 Scheduler::job_runnable(Transaction::Job *job)
 {
@@ -108,7 +241,11 @@ Scheduler::job_runnable(Transaction::Job *job)
 			std::cout << "Job " << *job << " must wait for "
 				  << *job2 << " to complete\n";
 #endif
-			if (job2->state != Transaction::Job::State::kSuccess)
+			/* a failed or cancelled job no longer holds us back */
+			if (among(job2->state,
+				{ Transaction::Job::kAwaiting,
+				    Transaction::Job::kQueued,
+				    Transaction::Job::kRunning }))
 				return false;
 		}
 	}
@@ -120,13 +257,12 @@ int
 Scheduler::tx_enqueue_leaves(Transaction *tx)
 {
 	for (auto &it : tx->jobs) {
-		auto job = it.second.front().get();
+		Transaction::Job *job;
 
 		if (it.second.empty())
 			continue;
 
-		if (job->id == -1)
-			job->id = last_jobid++;
+		job = it.second.front().get();
 
 		if (job_runnable(job)) {
 #ifdef TRACE
@@ -142,48 +278,122 @@ Scheduler::tx_enqueue_leaves(Transaction *tx)
 bool
 Scheduler::tx_enqueue(Schedulable::SPtr object, Transaction::JobType op)
 {
-	transactions.emplace(std::make_unique<Transaction>(*this, object, op));
-	transactions.front()->to_graph(std::cout);
-#if 1
-	tx_enqueue_leaves(transactions.front().get());
-#endif
+	tx_push(std::make_unique<Transaction>(*this, object, op));
 	return true;
 }
 
+void
+Scheduler::tx_push(std::unique_ptr<Transaction> tx)
+{
+	uint64_t now = monotonic_usec();
+
+	for (auto &group : tx->jobs)
+		for (auto &job : group.second)
+			job->times.enqueued = now;
+
+	transactions.emplace(std::move(tx));
+	transactions.back()->to_graph(std::cout);
+
+	/* later transactions start once those before them are finished */
+	if (transactions.size() == 1)
+		tx_enqueue_leaves(transactions.front().get());
+}
+
+void
+Scheduler::tx_advance()
+{
+	while (!transactions.empty() && transactions.front()->finished()) {
+		transactions.pop();
+		if (!transactions.empty())
+			tx_enqueue_leaves(transactions.front().get());
+	}
+}
+
 int
 Scheduler::job_complete(Transaction::Job::Id id, Transaction::Job::State res)
 {
-	auto job = running_jobs[id];
+	m_completions.push_back({ id, res, monotonic_usec() });
+	return 0;
+}
 
-	if (job->timer != 0)
-		app.del_timer(job->timer);
-	running_jobs.erase(id);
-	job->state = res;
-	log_job_complete(job);
+bool
+Scheduler::completions_pending() const
+{
+	return !m_completions.empty();
+}
+
+void
+Scheduler::dispatch_completions()
+{
+	std::vector<Completion> completions;
+	std::vector<Transaction::Job *> ready; /* jobs which may now run */
+	std::unordered_set<Transaction::Job *> seen;
+
+	/* completions reported while we process these wait for next time */
+	completions.swap(m_completions);
+
+	for (auto &completion : completions) {
+		Transaction::Job *job = job_get(completion.id);
+
+		if (job == NULL) {
+			log_dbg("Completion of job %" PRId64
+				" which isn't running\n",
+			    completion.id);
+			continue;
+		}
 
-	if (res == Transaction::Job::State::kSuccess &&
-	    job->type == Transaction::JobType::kRestart) {
-		/* restart jobs are converted to start jobs on success */
-		job->type = Transaction::JobType::kStart;
-		job->state = Transaction::Job::kAwaiting;
-		if (job_runnable(job))
+		if (job->timer != 0)
+			app.del_timer(job->timer);
+		running_jobs.erase(completion.id);
+		m_admission.release(job_restarter_type(job), job);
+		job->state = completion.state;
+		job->times.completed = completion.when;
+		log_job_complete(job);
+
+		if (job->state == Transaction::Job::State::kSuccess &&
+		    job->type == Transaction::JobType::kRestart) {
+			/* restart jobs are converted to start jobs on success */
+			job->type = Transaction::JobType::kStart;
+			job->state = Transaction::Job::kAwaiting;
+			if (seen.insert(job).second)
+				ready.push_back(job);
+		} else
+			job_record(job);
+
+		job_gather_ordered_after(job, ready, seen);
+
+		/* jobs requiring this one's success can now never succeed */
+		if (among(job->state,
+			{ Transaction::Job::kFailure, Transaction::Job::kTimeout,
+			    Transaction::Job::kCancelled }))
+			job_cancel_dependents(job, ready, seen);
+	}
+
+	/* the slots released may admit queued jobs */
+	job_admit_queued();
+
+	for (auto job : ready) {
+		if (job_runnable(job)) {
+#ifdef JOBSCHED_TRACE
+			std::cout << "Job " << *job << " may now run\n";
+#endif
 			job_run(job);
-		goto start_others;
+		}
 	}
 
-	/*
-	 * TODO: We need to make a design decision. Should we go through all the
-	 * jobs with requirement edge to the completed job, and fail them if
-	 * they have req=1, or should we simply rely on PropagateStopTo
-	 * dependencies instead?
-	 */
+	tx_advance();
+}
 
-start_others:
+void
+Scheduler::job_gather_ordered_after(Transaction::Job *job,
+    std::vector<Transaction::Job *> &ready,
+    std::unordered_set<Transaction::Job *> &seen)
+{
 	/*
-	 * For each object which has an ordering edge to the object whose job
-	 * has now completed, we check if a job exists for that object
-	 * within the transaction; if there is, we check if the job is
-	 * runnable, and run it if so.
+	 * Each object which has an ordering edge to the object whose job has
+	 * now completed may have a job within the transaction which can now
+	 * run. Gather these up; a job waiting on several of the jobs completed
+	 * is considered only once.
 	 */
 	for (auto &dep : job->object->edges_to) {
 		Transaction::Job *job2;
@@ -192,16 +402,113 @@ start_others:
 			continue;
 		else if ((job2 = transactions.front()->object_job_for(
 			      dep->from)) != NULL &&
-		    job_runnable(job2)) {
-#ifdef JOBSCHED_TRACE
-			std::cout << "Job " << *job2 << " may run now that "
-				  << *job << " is complete\n";
-#endif
-			job_run(job2);
+		    seen.insert(job2).second)
+			ready.push_back(job2);
+	}
+}
+
+void
+Scheduler::job_cancel_dependents(Transaction::Job *job,
+    std::vector<Transaction::Job *> &ready,
+    std::unordered_set<Transaction::Job *> &seen)
+{
+	Transaction *tx = transactions.front().get();
+	std::vector<Transaction::Job *> stack = { job };
+	bool goal_unreachable = job == tx->objective;
+
+	/*
+	 * Cancel every job which transitively requires this one. A job is
+	 * pushed only as it is cancelled, so each is visited at most once.
+	 * Jobs already running are left to complete; their own failure, if
+	 * any, continues the cascade then.
+	 */
+	while (!stack.empty()) {
+		Transaction::Job *failed = stack.back();
+
+		stack.pop_back();
+
+		for (auto req : failed->reqs_on) {
+			Transaction::Job *from = req->from;
+
+			if (!req->required)
+				continue;
+			if (req->goal_required || from == tx->objective)
+				goal_unreachable = true;
+			if (!job_cancel(from))
+				continue;
+
+			job_gather_ordered_after(from, ready, seen);
+			stack.push_back(from);
 		}
 	}
 
-	return 0;
+	if (goal_unreachable) {
+		/* nothing more is to be gained by running the rest */
+		std::cout << "Goal of transaction is unreachable; cancelling "
+			     "its remaining jobs\n";
+		for (auto &group : tx->jobs)
+			for (auto &job2 : group.second)
+				job_cancel(job2.get());
+	}
+}
+
+bool
+Scheduler::job_cancel(Transaction::Job *job)
+{
+	if (job->state == Transaction::Job::kQueued)
+		m_admission.withdraw(job_restarter_type(job), job);
+	else if (job->state != Transaction::Job::kAwaiting)
+		return false;
+
+	job->state = Transaction::Job::kCancelled;
+	job->times.completed = monotonic_usec();
+	log_job_complete(job);
+	job_record(job);
+
+	return true;
+}
+
+void
+Scheduler::job_record(Transaction::Job *job)
+{
+	JobRecord rec;
+
+	rec.id = job->id;
+	rec.object = job->object->id().name;
+	rec.type = Transaction::type_str(job->type);
+	rec.state = Transaction::Job::state_str(job->state);
+	rec.enqueued = job->times.enqueued;
+	rec.runnable = job->times.runnable;
+	rec.dispatched = job->times.dispatched;
+	rec.completed = job->times.completed;
+
+	/* what held it back: the jobs in the transaction it was ordered after */
+	for (auto &dep : job->object->edges) {
+		Transaction::Job *job2;
+
+		if (!(dep->type & Edge::kAfter))
+			continue;
+		else if ((job2 = transactions.front()->object_job_for(
+			      dep->to)) != NULL &&
+		    job->after_order(job2) == 1)
+			rec.after.push_back(job2->object->id().name);
+	}
+
+	m_history.push(std::move(rec));
+}
+
+int
+Scheduler::history_write(std::string path)
+{
+	std::ofstream out(path, std::ios::trunc);
+
+	if (!out)
+		return -errno;
+
+	m_history.write(out);
+	out.close();
+
+	return out.fail() ? -EIO : 0;
 }
 
 Schedulable *
@@ -245,6 +552,7 @@ Scheduler::object_load(std::vector<std::string> aliases,
 {
 	Schedulable::SPtr obj = std::make_shared<Schedulable>(aliases.front());
 	obj->state = Schedulable::kOffline;
+	obj->restarter = app.restarter_index(obj->id().type());
 
 	objects.insert(obj);
 
@@ -272,19 +580,13 @@ Scheduler::object_load(std::vector<std::string> aliases,
 	}
 }
 
-int
-Scheduler::object_set_state(ObjectId &id, Schedulable::State state)
-{
-	m_aliases[id]->state = state;
-	return 0;
-}
-
 #pragma region Logging
 
 static struct {
 	std::string code, msg;
 } job_complete_msg[Transaction::Job::State::kMax] = {
 	[Transaction::Job::State::kAwaiting] = {},
+	[Transaction::Job::State::kQueued] = {},
 	[Transaction::Job::State::kRunning] = {},
 	[Transaction::Job::State::kSuccess] = { ANSI_HL_GREEN, "  OK  " },
 	[Transaction::Job::State::kFailure] = { ANSI_HL_RED, " Fail " },
@@ -13,7 +13,10 @@
 
 #include "../app/evloop.h"
 #include "iwng_compat/misc_cxx.h"
+#include "iwng_compat/slotmap.h"
+#include "history.h"
 #include "object.h"
+#include "psi.h"
 
 class App;
 class Job;
@@ -27,6 +30,7 @@ class Task : Printable<Task> {
 
 	enum State {
 		kAwaiting,  /**< Not yet started */
+		kQueued,    /**< Runnable, but awaiting an admission slot */
 		kRunning,   /**< Currently running */
 		kSuccess,   /**< Completed successfully */
 		kFailure,   /**< Failed to complete*/
@@ -46,10 +50,24 @@ class Task : Printable<Task> {
 		kJob = 2,
 	};
 
+	/**
+	 * Points in the task's lifecycle, in microseconds on the monotonic
+	 * clock; 0 if not yet reached.
+	 */
+	struct Times {
+		uint64_t enqueued = 0;	 /**< its transaction was enqueued */
+		uint64_t runnable = 0;	 /**< no longer held back by ordering */
+		uint64_t dispatched = 0; /**< issued to the restarter */
+		uint64_t completed = 0;	 /**< completed or cancelled */
+	};
+
 	Id id = -1;		     /**< unique identifier */
 	State state = kAwaiting;     /**< state of the task */
 	Evloop::timerid_t timer = 0; /**< timeout timer id */
 	Flags flags = (Flags)0;	     /**< bitmask of flags for this job */
+	Times times;		     /**< lifecycle timestamps */
+
+	static const char *state_str(State state);
 
 	std::ostream &print(std::ostream &os) const;
 };
@@ -153,7 +171,7 @@ class Transaction {
 	Scheduler &sched; /**< the scheduler this tx is associated with */
 	std::map<Schedulable::SPtr, std::list<std::unique_ptr<Job>>>
 	    jobs;	/**< maps objects to all jobs for that object */
-	Job *objective; /**< the job this tx aims to achieve */
+	Job *objective = NULL; /**< the job this tx aims to achieve */
 
 	/**
 	 * Returns whichever job type results from merging types \p a and \p b,
@@ -176,6 +194,12 @@ class Transaction {
 	Job *job_submit(Schedulable::SPtr object, JobType op,
 	    bool is_goal = false);
 
+	/**
+	 * Check the transaction is acyclic and merge jobs on the same object.
+	 * Throws if either is impossible.
+	 */
+	void prepare();
+
     private:
 	typedef std::map<Schedulable::SPtr,
 	    std::list<std::unique_ptr<Job>>>::iterator JobIterator;
@@ -225,6 +249,17 @@ class Transaction {
 
     public:
 	Transaction(Scheduler &sched, Schedulable::SPtr object, JobType op);
+	/**
+	 * Create an empty pseudotransaction. It has no objective; the
+	 * event-based impurity adds jobs to it, then prepares it.
+	 */
+	Transaction(Scheduler &sched)
+	    : sched(sched) {};
+
+	/** Are there no jobs in the transaction? */
+	bool empty() const;
+	/** Have all jobs in the transaction run to completion? */
+	bool finished() const;
 
 	/**
 	 * Return the first job (if any) for a given object.
@@ -240,6 +275,83 @@ class Transaction {
 	void to_graph(std::ostream &out) const;
 };
 
+/**
+ * Admission control for jobs.
+ *
+ * Bounds the number of jobs running at once, both in total and per restarter
+ * type, so that a boot or a mass restart does not start every leaf job at once.
+ * Jobs refused a slot wait in a FIFO queue for their restarter type; these
+ * queues are served round-robin as slots are released.
+ */
+class Admission {
+    public:
+	/** Default global limit, as a multiple of the number of online CPUs. */
+	static constexpr unsigned kJobsPerCPU = 4;
+
+	Admission();
+
+	/** Set the global limit on running jobs. 0 means unlimited. */
+	void set_limit(unsigned limit);
+	/** Set the limit on running jobs of a restarter type. 0 = unlimited. */
+	void set_limit(size_t type, unsigned limit);
+	/**
+	 * Set the limit on running start jobs, as adapted to system pressure.
+	 * It is clamped to the global limit. 0 means unlimited.
+	 */
+	void set_start_limit(unsigned limit);
+	/** Get the limit on running start jobs. */
+	unsigned start_limit() const;
+	/** Get the global limit on running jobs. */
+	unsigned limit() const;
+	/** Are any jobs running or queued? */
+	bool busy() const;
+	/** Are any jobs queued for want of a slot? */
+	bool waiting() const;
+
+	/**
+	 * Try to take a slot for \p job of restarter type \p type.
+	 * @retval true A slot was taken; the job may be dispatched.
+	 * @retval false No slot is free; the job was queued.
+	 */
+	bool admit(size_t type, Transaction::Job *job);
+	/** Release the slot held by \p job of restarter type \p type. */
+	void release(size_t type, Transaction::Job *job);
+	/** Remove a queued job of restarter type \p type from its queue. */
+	void withdraw(size_t type, Transaction::Job *job);
+	/**
+	 * Take a slot for the next queued job which may now run, if any.
+	 * @retval NULL No queued job may be admitted now.
+	 */
+	Transaction::Job *next();
+
+    protected:
+	/** Slots and wait queue for one restarter type. */
+	struct Class {
+		unsigned limit = 0;   /**< max running jobs; 0 = unlimited */
+		unsigned running = 0; /**< jobs currently holding a slot */
+		std::list<Transaction::Job *> waiting; /**< jobs queued */
+	};
+	typedef std::list<Transaction::Job *>::iterator QueuePos;
+
+	unsigned m_limit;	  /**< global limit; 0 = unlimited */
+	unsigned m_running = 0; /**< jobs currently holding a slot */
+	unsigned m_start_limit = 0;   /**< start job limit; 0 = unlimited */
+	unsigned m_running_starts = 0; /**< start jobs holding a slot */
+	std::vector<Class> m_classes; /**< indexed by restarter type */
+	std::list<size_t> m_rr; /**< classes with jobs waiting, in turn */
+	std::unordered_map<Transaction::Job *, QueuePos>
+	    m_queued; /**< where each queued job is in its class's queue */
+
+	/** Get the class for a restarter type index. */
+	Class &get_class(size_t type);
+	/** Is the job one which may start its object? */
+	static bool is_start(Transaction::Job *job);
+	/** Can \p job of class \p cls take a slot now? */
+	bool slot_free(Class &cls, Transaction::Job *job) const;
+	/** Take a slot for \p job of class \p cls. */
+	void take(Class &cls, Transaction::Job *job);
+};
+
 /*
  * The scheduler itself.
  *
@@ -258,13 +370,57 @@ class Scheduler {
 	std::queue<ObjectId> m_loadqueue; /**< object IDs to be loaded */
 	std::queue<std::unique_ptr<Transaction>>
 	    transactions; /**< the transaction queue */
-	std::unordered_map<Transaction::Job::Id, Transaction::Job *>
-	    running_jobs;		     /**< jobs currently running */
-	Transaction::Job::Id last_jobid = 0; /**< job id counter */
+	SlotMap<Transaction::Job *>
+	    running_jobs; /**< jobs currently running, by job ID */
+	/** A job completion notified by a restarter. */
+	struct Completion {
+		Transaction::Job::Id id;
+		Transaction::Job::State state;
+		uint64_t when; /**< time of notification */
+	};
+	std::vector<Completion>
+	    m_completions; /**< job completions yet to be processed */
+	Admission m_admission; /**< limits on concurrently running jobs */
+
+	/** A net change in an object's state within a loop iteration. */
+	struct StateChange {
+		Schedulable::SPtr object;
+		Schedulable::State from; /**< state before the first change */
+		Schedulable::State to;	 /**< state after the last change */
+		bool expected; /**< were all changes due to a running job? */
+	};
+	std::vector<StateChange>
+	    m_state_changes; /**< changes awaiting the impurity */
+	std::unordered_map<Schedulable *, size_t>
+	    m_state_change_idx; /**< object to index in #m_state_changes */
+	PSI m_psi;	       /**< system pressure sampler */
+	Evloop::timerid_t m_psi_timer = 0; /**< pressure sampling timer */
+	JobHistory m_history; /**< records of recently completed jobs */
 
     private:
-	/** Invoke restarter & places the job in the #running_jobs map. */
+	/**
+	 * Run a job if an admission slot is free, otherwise queue it to run
+	 * when one is released.
+	 */
 	int job_run(Transaction::Job *job);
+	/**
+	 * Invoke restarter & places the job in the #running_jobs map, which
+	 * issues its ID.
+	 */
+	int job_dispatch(Transaction::Job *job);
+	/** Dispatch queued jobs for as long as admission slots are free. */
+	void job_admit_queued();
+	/** Index of the type of restarter which is to run the job. */
+	size_t job_restarter_type(Transaction::Job *job);
+
+	/** Arm the pressure sampling timer if it isn't already armed. */
+	void psi_arm();
+	/**
+	 * Called periodically while jobs run. Adapts the limit on running
+	 * start jobs to system pressure: it grows while pressure stays low and
+	 * jobs are waiting, and shrinks when stalls climb.
+	 */
+	void psi_timer_cb(Evloop::timerid_t id, uintptr_t udata);
 	/**
 	 * Is this job ready to run? Namely, are there any jobs pending in the
 	 * currently-running transaction which must come before it?
@@ -272,6 +428,28 @@ class Scheduler {
 	bool job_runnable(Transaction::Job *job);
 	/** Called when a job has timed out. */
 	void job_timeout_cb(Evloop::timerid_t id, uintptr_t udata);
+	/**
+	 * Add to \p ready the jobs ordered after \p job, which may be able to
+	 * run now it is no longer pending, unless already in \p seen.
+	 */
+	void job_gather_ordered_after(Transaction::Job *job,
+	    std::vector<Transaction::Job *> &ready,
+	    std::unordered_set<Transaction::Job *> &seen);
+	/**
+	 * Cancel all jobs which require, directly or transitively, the success
+	 * of \p job, which has failed. If the goal of the transaction is thus
+	 * made unreachable, the rest of its pending jobs are cancelled too.
+	 * Jobs ordered after the cancelled jobs are gathered into \p ready.
+	 */
+	void job_cancel_dependents(Transaction::Job *job,
+	    std::vector<Transaction::Job *> &ready,
+	    std::unordered_set<Transaction::Job *> &seen);
+	/**
+	 * Cancel a job if it has not yet been dispatched.
+	 * @retval true The job was cancelled.
+	 * @retval false The job is running or already complete.
+	 */
+	bool job_cancel(Transaction::Job *job);
 
 	/**
 	 * Remap all edges from to and to an object, which are not owned by that
@@ -282,17 +460,40 @@ class Scheduler {
 
 	/** Enqueue the set of leaf jobs ready to start immediately. */
 	int tx_enqueue_leaves(Transaction *tx);
+	/** Add a transaction to the queue; start it if at the head. */
+	void tx_push(std::unique_ptr<Transaction> tx);
+	/**
+	 * Retire the transaction at the head of the queue if all its jobs have
+	 * completed, and start the next.
+	 */
+	void tx_advance();
 
 	/** Log that a job has completed. */
 	void log_job_complete(Transaction::Job * job);
+	/** Add a record of a job which has reached a final state to history. */
+	void job_record(Transaction::Job *job);
 
     public:
+	static constexpr int kPSIIntervalMs = 250; /**< pressure sample period */
+	static constexpr int kPSILow = 10;	/**< grow start limit below this % */
+	static constexpr int kPSIHigh = 40; /**< shrink start limit above this % */
+	static constexpr unsigned kPSIMinStarts = 2; /**< start limit floor */
+
 	/** Create a new scheduler as part of a given app. */
-	Scheduler(App &app)
-	    : app(app) {};
+	Scheduler(App &app);
 
 	void dispatch_load_queue();
 
+	/**
+	 * Set the limit on how many jobs may run at once. 0 means unlimited.
+	 */
+	void set_job_limit(unsigned limit);
+	/**
+	 * Set the limit on how many jobs of a restarter type may run at once.
+	 * 0 means unlimited.
+	 */
+	void set_restarter_job_limit(std::string type, unsigned limit);
+
 	/**
 	 * Add an edge from one object to another. If the to-node does not
 	 * exist, a placeholder is created.
@@ -305,11 +506,27 @@ class Scheduler {
 	 */
 	Transaction::Job *job_get(Transaction::Job::Id id);
 	/**
-	 * Notify the scheduler of the completion of a job.
+	 * Notify the scheduler of the completion of a job. The completion is
+	 * queued, and processed by the next dispatch_completions().
 	 */
 	int job_complete(Transaction::Job::Id id, Transaction::Job::State res);
+	/** Are any job completions awaiting dispatch_completions()? */
+	bool completions_pending() const;
+	/**
+	 * Process all job completions queued so far, then run whichever jobs
+	 * they have made runnable. Called once per event loop iteration.
+	 */
+	void dispatch_completions();
 	/** @} */
 
+	/**
+	 * Write the records of recently completed jobs, as kept in the job
+	 * history ring, to a file.
+	 * @retval 0 History written.
+	 * @retval -errno Failed to write the file.
+	 */
+	int history_write(std::string path);
+
 	/**
 	 * Add an object created outwith the scheduler.
 	 */
@@ -340,7 +557,16 @@ class Scheduler {
 	 * means give rise to automatic transactions generated by the
 	 * event-driven impurity.
 	 */
-	int object_set_state(ObjectId &id, Schedulable::State state);
+	int object_set_state(const ObjectId &id, Schedulable::State state);
+	/** Are any state changes awaiting dispatch_state_changes()? */
+	bool state_changes_pending() const;
+	/**
+	 * Run the event-based impurity over the state changes notified since
+	 * the last call. The jobs called for by the post-facto and event edges
+	 * of every changed object are gathered into a single pseudotransaction,
+	 * which is then enqueued. Called once per event loop iteration.
+	 */
+	void dispatch_state_changes();
 
 	/**
 	 * Generate and enqueue a transaction.
@@ -3,6 +3,22 @@
 
 #include "scheduler.h"
 
+const char *
+Task::state_str(State state)
+{
+	static const char *const strs[kMax] = {
+		[kAwaiting] = "awaiting",
+		[kQueued] = "queued",
+		[kRunning] = "running",
+		[kSuccess] = "success",
+		[kFailure] = "failure",
+		[kTimeout] = "timeout",
+		[kCancelled] = "cancelled",
+	};
+
+	return state >= 0 && state < kMax ? strs[state] : "<invalid>";
+}
+
 std::ostream &
 Transaction::Job::print(std::ostream &os) const
 {
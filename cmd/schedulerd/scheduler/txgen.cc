@@ -9,11 +9,37 @@ Transaction::Transaction(Scheduler &sched, Schedulable::SPtr object, JobType op)
 {
 	objective = job_submit(object, op, true);
 	// to_graph(std::cout);
+	prepare();
+	// to_graph(std::cout);
+}
+
+void
+Transaction::prepare()
+{
 	if (!verify_acyclic())
 		throw("Transaction is unresolveably cyclical");
 	if (merge_jobs() < 0)
 		throw("Transaction contains unmergeable jobs");
-	// to_graph(std::cout);
+}
+
+bool
+Transaction::empty() const
+{
+	for (auto &group : jobs)
+		if (!group.second.empty())
+			return false;
+	return true;
+}
+
+bool
+Transaction::finished() const
+{
+	for (auto &group : jobs)
+		for (auto &job : group.second)
+			if (among(job->state,
+				{ Job::kAwaiting, Job::kQueued, Job::kRunning }))
+				return false;
+	return true;
 }
 
 Transaction::Job::~Job()
@@ -1,6 +1,4 @@
 
-#include <sys/event.h>
-
 #include <cassert>
 #include <fstream>
 #include <functional>
@@ -26,7 +24,7 @@ main(int argc, char *argv[])
 	app.m_sched.dispatch_load_queue();
 	auto myobj = app.m_sched.object_get(def)->shared_from_this();
 
-	app.restarters["target"] = new TargetRestarter(app.m_sched);
+	app.restarter_register("target", new TargetRestarter(app.m_sched));
 
 	app.m_sched.tx_enqueue(myobj, Transaction::kStart);
 
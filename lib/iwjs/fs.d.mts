@@ -18,6 +18,13 @@ export function getLinkedNames(path: string): Array<string>;
  */
 export function openSync(path: string, flags: number, mode: number): number;
 
+/**
+ * Read an entire file on a worker thread, without blocking the event loop.
+ * The promise is rejected with an Error bearing an `errno` property on
+ * failure.
+ */
+export function readFile(path: string): Promise<ArrayBuffer>;
+
 /**
  * Synchronously retrieve a list of all files within a directory.
  */
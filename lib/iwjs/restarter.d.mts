@@ -6,4 +6,45 @@ export abstract class Restarter {
 
 	abstract startJob(jobID: number);
 	abstract stopJob(jobID: number);
-}
\ No newline at end of file
+
+	/**
+	 * Launch a process on behalf of an object. Its exit is reported by a
+	 * call to processExited().
+	 * @returns The PID of the process, or a negative errno.
+	 */
+	spawn(object: string, argv: Array<string>): number;
+
+	/**
+	 * Send a signal to a process launched by spawn(). Unlike kill(2), this
+	 * can't signal an unrelated process which has since taken the PID.
+	 * @returns 0, or a negative errno.
+	 */
+	kill(pid: number, signo: number): number;
+
+	/**
+	 * Send a signal to every process in an object's cgroup, including
+	 * those forked off by processes launched by spawn().
+	 * @returns 0, or a negative errno.
+	 */
+	killAll(object: string, signo: number): number;
+
+	/**
+	 * Called when a process launched by spawn() has exited. The code and
+	 * status are the si_code and si_status of waitid(2).
+	 */
+	processExited?(object: string, pid: number, code: number,
+		status: number): void;
+
+	/**
+	 * Called when the last process in an object's cgroup has exited. For a
+	 * forking daemon, whose main process exits early, this rather than
+	 * processExited() tells that a stop job is complete.
+	 */
+	cgroupEmpty?(object: string): void;
+}
+
+/**
+ * Register a restarter as the one in charge of all objects of a type, e.g.
+ * "service".
+ */
+export function registerRestarter(type: string, restarter: Restarter): void;
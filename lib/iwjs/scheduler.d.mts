@@ -44,6 +44,25 @@ export interface Scheduler {
 	 * Complete a job.
 	 */
 	jobComplete(jobID: number, state: jobTypes): void;
+
+	/**
+	 * Set the limit on how many jobs may run at once; 0 for no limit.
+	 * Defaults to a multiple of the number of online CPUs.
+	 */
+	setJobLimit(limit: number): void;
+
+	/**
+	 * Set the limit on how many jobs of a given restarter type (e.g.
+	 * "service") may run at once; 0 for no limit.
+	 */
+	setRestarterJobLimit(type: string, limit: number): void;
+
+	/**
+	 * Write the timeline of recently completed jobs to a file: when each
+	 * was enqueued, became runnable, was dispatched, and completed, and
+	 * which jobs it was ordered after. Returns 0 or a negative errno.
+	 */
+	writeJobHistory(path: string): number;
 }
 
 /** The global job scheduler. */
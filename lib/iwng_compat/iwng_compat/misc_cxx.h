@@ -6,6 +6,8 @@
 #define MISC_CXX_H_
 
 #include <algorithm>
+#include <cstdint>
+#include <ctime>
 #include <map>
 #include <memory>
 
@@ -44,6 +46,16 @@ among(const T &variable, std::initializer_list<T> values)
 	    std::end(values));
 }
 
+/** Microseconds elapsed on the monotonic clock. */
+inline uint64_t
+monotonic_usec()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /** To erase from a multimap if a predicate is satisfied. */
 template <typename MapT, typename PredT>
 void
@@ -0,0 +1,84 @@
+/*
+ * Lock-free multiple-producer, single-consumer queue
+ */
+
+#ifndef MPSC_H_
+#define MPSC_H_
+
+#include <atomic>
+#include <utility>
+
+/**
+ * An unbounded queue to which any thread may push without locking, and from
+ * which a single thread pops. After Dmitry Vyukov's node-based design: a push
+ * is an atomic exchange of the head, and a pop never contends with pushes
+ * except on the last node.
+ */
+template <typename T> class MPSCQueue {
+    public:
+	MPSCQueue();
+	~MPSCQueue();
+
+	/** Push a value. May be called from any thread. */
+	void push(T val);
+	/**
+	 * Pop the oldest value into \p out. Only the consumer may call this.
+	 * @retval false The queue is empty, or a push is midway through.
+	 */
+	bool pop(T &out);
+
+    private:
+	struct Node {
+		std::atomic<Node *> next { nullptr };
+		T val;
+	};
+
+	std::atomic<Node *> m_head; /**< most recently pushed; producers */
+	Node *m_tail;		    /**< stub or last popped; consumer */
+};
+
+/* template implementations */
+template <typename T> MPSCQueue<T>::MPSCQueue()
+{
+	m_tail = new Node;
+	m_head.store(m_tail, std::memory_order_relaxed);
+}
+
+template <typename T> MPSCQueue<T>::~MPSCQueue()
+{
+	T val;
+
+	while (pop(val))
+		;
+	delete m_tail;
+}
+
+template <typename T>
+void
+MPSCQueue<T>::push(T val)
+{
+	Node *node = new Node, *prev;
+
+	node->val = std::move(val);
+	prev = m_head.exchange(node, std::memory_order_acq_rel);
+	prev->next.store(node, std::memory_order_release);
+}
+
+template <typename T>
+bool
+MPSCQueue<T>::pop(T &out)
+{
+	Node *next = m_tail->next.load(std::memory_order_acquire);
+
+	if (next == nullptr)
+		return false;
+
+	/* next becomes the new stub; its value is taken out */
+	out = std::move(next->val);
+	delete m_tail;
+	m_tail = next;
+
+	return true;
+}
+
+#endif /* MPSC_H_ */
@@ -0,0 +1,135 @@
+/*
+ * Generational slot map
+ */
+
+#ifndef SLOTMAP_H_
+#define SLOTMAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * A map from handles to values, where the map assigns the handles.
+ *
+ * A handle is made of a slot index in its low 32 bits and the generation of
+ * that slot in the high bits. Lookup is an array index and a comparison of
+ * generations; a slot's generation is advanced as its value is erased, so
+ * stale handles are rejected rather than finding whichever value came to
+ * occupy the slot next. Handles are always non-negative.
+ */
+template <typename T> class SlotMap {
+    public:
+	typedef int64_t Handle;
+
+	/** Add a value, returning the handle by which to find it. */
+	Handle insert(T val);
+	/**
+	 * Find the value with the given handle.
+	 * @retval NULL The handle is stale or was never issued.
+	 */
+	T *get(Handle handle);
+	/**
+	 * Remove the value with the given handle.
+	 * @retval false The handle is stale or was never issued.
+	 */
+	bool erase(Handle handle);
+	/** Number of values held. */
+	size_t size() const;
+
+    private:
+	struct Slot {
+		uint32_t generation = 1; /**< 0 is never issued */
+		bool occupied = false;
+		T val;
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_free; /**< indices of unoccupied slots */
+	size_t m_size = 0;
+
+	static Handle make_handle(uint32_t idx, uint32_t generation);
+	/** Find the slot for a handle if it is current and occupied. */
+	Slot *slot_for(Handle handle);
+};
+
+/* template implementations */
+template <typename T>
+typename SlotMap<T>::Handle
+SlotMap<T>::make_handle(uint32_t idx, uint32_t generation)
+{
+	return (Handle)generation << 32 | idx;
+}
+
+template <typename T>
+typename SlotMap<T>::Slot *
+SlotMap<T>::slot_for(Handle handle)
+{
+	uint32_t idx = handle & UINT32_MAX, generation = handle >> 32;
+
+	if (handle < 0 || idx >= m_slots.size())
+		return NULL;
+	else if (!m_slots[idx].occupied ||
+	    m_slots[idx].generation != generation)
+		return NULL;
+	return &m_slots[idx];
+}
+
+template <typename T>
+typename SlotMap<T>::Handle
+SlotMap<T>::insert(T val)
+{
+	uint32_t idx;
+
+	if (!m_free.empty()) {
+		idx = m_free.back();
+		m_free.pop_back();
+	} else {
+		idx = m_slots.size();
+		m_slots.emplace_back();
+	}
+
+	m_slots[idx].occupied = true;
+	m_slots[idx].val = std::move(val);
+	m_size++;
+
+	return make_handle(idx, m_slots[idx].generation);
+}
+
+template <typename T>
+T *
+SlotMap<T>::get(Handle handle)
+{
+	Slot *slot = slot_for(handle);
+	return slot == NULL ? NULL : &slot->val;
+}
+
+template <typename T>
+bool
+SlotMap<T>::erase(Handle handle)
+{
+	Slot *slot = slot_for(handle);
+
+	if (slot == NULL)
+		return false;
+
+	slot->occupied = false;
+	slot->val = T();
+	/* keep handles non-negative; generation 0 is never issued */
+	if (++slot->generation > INT32_MAX)
+		slot->generation = 1;
+	m_free.push_back(slot - m_slots.data());
+	m_size--;
+
+	return true;
+}
+
+template <typename T>
+size_t
+SlotMap<T>::size() const
+{
+	return m_size;
+}
+
+#endif /* SLOTMAP_H_ */